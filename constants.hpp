@@ -52,6 +52,7 @@
 #include <set>
 #include <tuple>
 #include <stack>
+#include <queue>
 #include <cmath>
 #include "omp.h"
 #include <limits>
@@ -67,6 +68,8 @@
 #include <utility>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
 #include <dirent.h>
 
 #pragma GCC diagnostic push
@@ -85,15 +88,21 @@ namespace depth
 template<int N> class faster;
 template<int N> struct bool_function_t;
 template<int N> struct function_t;
+template<int N> class graphe_t;
+template<int N> class successor_list_t;
 struct bool_op_t;
 }
 
 template<int N> struct function_t;
+template<int N> struct analysis_context;
 template<int N> struct evaluator;
+template<int N> struct batch_evaluator;
 
 namespace weight
 {
 template<int N> class lighter;
+template<int N> class graphe_t;
+template<int N> struct node_t;
 struct bool_op_t;
 }
 
@@ -120,8 +129,12 @@ struct bool_op_t;
 #define CHECK(x) x
 #endif
 
+// Define NFWHT to compute the LAT by brute force instead of the fast Walsh-Hadamard transform
+//#define NFWHT
+
 #define ALIGNED_(x) __attribute__((aligned(x)))
 #define ALIGNED_TYPE_(t,x) t ALIGNED_(x)
+#define NOINLINE_ __attribute__((noinline))
 
 template<int N>
 using UINT_ =
@@ -200,6 +213,7 @@ using UINT_ =
 
 #define LUT_ULL_N ((LUT_BYTE_N + 7) / 8)
 #define LUT_XMM_N ((LUT_UNIT_N + 15) / 16)
+#define WALSH_YMM_N ((LUT_UNIT_N + 15) / 16)
 
 template<int N>
 using bit_slice_l_t = std::array<UINT_<N>, UNIT_N>;
@@ -293,55 +307,42 @@ const __m128i xd = _mm_set_epi8(0xd, 0xd, 0xd, 0xd, 0xd, 0xd, 0xd, 0xd, 0xd, 0xd
 const __m128i xe = _mm_set_epi8(0xe, 0xe, 0xe, 0xe, 0xe, 0xe, 0xe, 0xe, 0xe, 0xe, 0xe, 0xe, 0xe, 0xe, 0xe, 0xe);
 const __m128i xf = _mm_set_epi8(0xf, 0xf, 0xf, 0xf, 0xf, 0xf, 0xf, 0xf, 0xf, 0xf, 0xf, 0xf, 0xf, 0xf, 0xf, 0xf);
 
-const __m128i S3_valv_mask8 = _mm_set_epi64x(0x0ULL, 0xffffffULL);
-const __m128i S3_valv_mask4 = _mm_set_epi64x(0x0ULL, 0xf0f0f0ULL);
-const __m128i S3_valv_mask2 = _mm_set_epi64x(0x0ULL, 0xccccccULL);
-const __m128i S3_valv_mask1 = _mm_set_epi64x(0x0ULL, 0xaaaaaaULL);
-
 const __m128i S3_comps_ind_mask  = _mm_set_epi64x(0x0ULL, 0x8080808080808080ULL);
 const __m128i S3_comps_deg_mask3 = _mm_set_epi64x(0x0ULL, 0x8080808080808080ULL); // 1000 0000
 const __m128i S3_comps_deg_mask2 = _mm_set_epi64x(0x0ULL, 0x6868686868686868ULL); // 0110 1000
 const __m128i S3_comps_deg_mask1 = _mm_set_epi64x(0x0ULL, 0x1616161616161616ULL); // 0001 0110
 
-const __m128i S3_coors_ind_mask  = _mm_set_epi64x(0x0ULL, 0x808080ULL);
-const __m128i S3_coors_deg_mask3 = _mm_set_epi64x(0x0ULL, 0x808080ULL); // 1000 0000
-const __m128i S3_coors_deg_mask2 = _mm_set_epi64x(0x0ULL, 0x686868ULL); // 0110 1000
-const __m128i S3_coors_deg_mask1 = _mm_set_epi64x(0x0ULL, 0x161616ULL); // 0001 0110
-
-const __m128i S4_valv_maskg = _mm_set_epi64x(0x0ULL, 0xffffffffffffffffULL);
-const __m128i S4_valv_mask8 = _mm_set_epi64x(0x0ULL, 0xff00ff00ff00ff00ULL);
-const __m128i S4_valv_mask4 = _mm_set_epi64x(0x0ULL, 0xf0f0f0f0f0f0f0f0ULL);
-const __m128i S4_valv_mask2 = _mm_set_epi64x(0x0ULL, 0xccccccccccccccccULL);
-const __m128i S4_valv_mask1 = _mm_set_epi64x(0x0ULL, 0xaaaaaaaaaaaaaaaaULL);
-
 const __m256i S4_comps_ind_mask  = _mm256_set_epi64x(0x8000800080008000ULL, 0x8000800080008000ULL, 0x8000800080008000ULL, 0x8000800080008000ULL);                                                                                                                                           // fedc ba98 7654 3210
 const __m256i S4_comps_deg_mask4 = _mm256_set_epi64x(0x8000800080008000ULL, 0x8000800080008000ULL, 0x8000800080008000ULL, 0x8000800080008000ULL); // 1000 0000 0000 0000
 const __m256i S4_comps_deg_mask3 = _mm256_set_epi64x(0x6880688068806880ULL, 0x6880688068806880ULL, 0x6880688068806880ULL, 0x6880688068806880ULL); // 0110 1000 1000 0000
 const __m256i S4_comps_deg_mask2 = _mm256_set_epi64x(0x1668166816681668ULL, 0x1668166816681668ULL, 0x1668166816681668ULL, 0x1668166816681668ULL); // 0001 0110 0110 1000
 const __m256i S4_comps_deg_mask1 = _mm256_set_epi64x(0x0116011601160116ULL, 0x0116011601160116ULL, 0x0116011601160116ULL, 0x0116011601160116ULL); // 0000 0001 0001 0110
 
-const __m128i S4_coors_ind_mask  = _mm_set_epi64x(0x0ULL, 0x8000800080008000ULL);                                                                                                                                                      // fedc ba98 7654 3210
-const __m128i S4_coors_deg_mask4 = _mm_set_epi64x(0x0ULL, 0x8000800080008000ULL); // 1000 0000 0000 0000
-const __m128i S4_coors_deg_mask3 = _mm_set_epi64x(0x0ULL, 0x6880688068806880ULL); // 0110 1000 1000 0000
-const __m128i S4_coors_deg_mask2 = _mm_set_epi64x(0x0ULL, 0x1668166816681668ULL); // 0001 0110 0110 1000
-const __m128i S4_coors_deg_mask1 = _mm_set_epi64x(0x0ULL, 0x0116011601160116ULL); // 0000 0001 0001 0110
+// The Hamming weight order tables are generated at compile time (flat
+// arrays in read-only data, nothing to run at start-up)
+template<int L>
+struct int_table_t
+{
+  int v[L];
+  constexpr const int & operator[](int i) const { return v[i]; }
+};
 
 template<int N>
-const array<int, N+1> HWorder_off = []
+constexpr int_table_t<N+1> make_HWorder_off()
 {
-  array<int, N+1> aHWorder_off;
-  aHWorder_off[0] = 0;
+  int_table_t<N+1> aHWorder_off = {};
+  aHWorder_off.v[0] = 0;
   for (int i = 1; i <= N; i++)
   {
-    aHWorder_off[i] = aHWorder_off[i - 1] + C(N, i-1);
+    aHWorder_off.v[i] = aHWorder_off.v[i - 1] + C(N, i-1);
   }
   return aHWorder_off;
-}();
+}
 
 template<int N>
-const array<int, 1<<N> HWorder = []
+constexpr int_table_t<1<<N> make_HWorder()
 {
-  array<int, 1<<N> aHWorder;
+  int_table_t<1<<N> aHWorder = {};
   int offset[N + 1] = { 0 };
   offset[0] = 0;
   for (int i = 1; i <= N; i++)
@@ -350,12 +351,18 @@ const array<int, 1<<N> HWorder = []
   }
   for (int i = 0; i < (1<<N); i++)
   {
-    int hw = _mm_popcnt_u32(i);
-    aHWorder[offset[hw]] = i;
+    int hw = __builtin_popcount(i);
+    aHWorder.v[offset[hw]] = i;
     offset[hw]++;
   }
   return aHWorder;
-}();
+}
+
+template<int N>
+constexpr int_table_t<N+1> HWorder_off = make_HWorder_off<N>();
+
+template<int N>
+constexpr int_table_t<1<<N> HWorder = make_HWorder<N>();
 
 
 template<int N>
@@ -1085,25 +1092,37 @@ struct Perm_t
 };
 
 
+// PE<N>(), XE<N>() and G_Rs<N>() are built on first use (thread-safe
+// function-local statics), so that a binary only pays for the tables
+// of the sizes it actually works on
+
 template<int N>
-const Perm_t<N> PE;
+const Perm_t<N> & PE()
+{
+  static const Perm_t<N> the_PE;
+  return the_PE;
+}
 
 template<int N>
-const array<Peigen::function_t<N>, (1<<N)> XE = []
+const array<Peigen::function_t<N>, (1<<N)> & XE()
 {
-  Peigen::function_t<N> I = Peigen::function_t<N>::INPUT_DEFAULT();
-  array<Peigen::function_t<N>, (1<<N)> aXE;
-  for (int ix = 0; ix < (1<<N); ix++)
+  static const array<Peigen::function_t<N>, (1<<N)> the_XE = []
   {
-    for (int i = 0; i < N; i++)
+    Peigen::function_t<N> I = Peigen::function_t<N>::INPUT_DEFAULT();
+    array<Peigen::function_t<N>, (1<<N)> aXE;
+    for (int ix = 0; ix < (1<<N); ix++)
     {
-      if ((ix >> i) & 1) aXE[ix].bit_slice[i] = ~I.bit_slice[i];
-      else aXE[ix].bit_slice[i] = I.bit_slice[i];
+      for (int i = 0; i < N; i++)
+      {
+        if ((ix >> i) & 1) aXE[ix].bit_slice[i] = ~I.bit_slice[i];
+        else aXE[ix].bit_slice[i] = I.bit_slice[i];
+      }
+      aXE[ix].bit_slice_to_LUT();
     }
-    aXE[ix].bit_slice_to_LUT();
-  }
-  return aXE;
-}();
+    return aXE;
+  }();
+  return the_XE;
+}
 
 template<int N>
 const bit_slice_t<N> masks = []
@@ -1122,6 +1141,43 @@ const bit_slice_t<N> masks = []
   return amask;
 }();
 
+// masks<N>[j] repeated over 256 bits, for the bitsliced transforms of
+// 256 / 2^N Boolean functions at once (N <= 8)
+// (a plain struct, std::array<__m256i> would drop the vector alignment)
+template<int N>
+struct masks_256_t
+{
+  __m256i m[N];
+  const __m256i & operator[](int j) const { return m[j]; }
+};
+
+template<int N>
+const masks_256_t<N> masks_256 = []
+{
+  masks_256_t<N> amask;
+  for (int j = 0; j < N; j++)
+  {
+    ALIGNED_TYPE_(uint8_t, 32) bytes[32];
+    int len = BIT_SLICE_BYTES_N < 32 ? BIT_SLICE_BYTES_N : 32;
+    for (int k = 0; k < 32; k += len) memcpy(bytes + k, masks<N>[j].data(), len);
+    amask.m[j] = _mm256_load_si256((__m256i *)bytes);
+  }
+  return amask;
+}();
+
+// HWmasks<N>[k], the monomials of degree k, i.e. the u with Hamming weight k
+template<int N>
+const array<bit_slice_l_t<N>, N+1> HWmasks = []
+{
+  array<bit_slice_l_t<N>, N+1> amask = {{}};
+  for (int u = 0; u < (1<<N); u++)
+  {
+    UINT_<N> * dst = (UINT_<N> *)amask[_mm_popcnt_u32(u)].data();
+    dst[u / UNIT_BIT_N] |= ((UINT_<N>)1) << (u % UNIT_BIT_N);
+  }
+  return amask;
+}();
+
 #include "OptimalSboxes.hpp"
 #include "AffineMatrixColPEBox.hpp"
 #include "AffineMatrixRowPEBox.hpp"
@@ -1135,32 +1191,225 @@ struct LExinfoGx_t
   uint8_t c;
 };
 
+// Memoization of function_t<N>::LE_representative(), keyed by the LUT of
+// the permutation: a table of about LE_CACHE_BYTES bytes (64K entries for
+// N = 4) in buckets of two slots, the newest entry first; inserting into a
+// full bucket evicts its older entry. It is shared by the threads (the
+// accesses are in the critical section LE_cache) and allocated on the
+// first insert. Compile with -DLE_CACHE_BYTES=0 to disable it.
+#ifndef LE_CACHE_BYTES
+#define LE_CACHE_BYTES (1<<22)
+#endif
+
 template<int N>
-const map<array<uint8_t, LUT_UNIT_N>, LExinfoGx_t<N> > G_Rs = []
+struct LE_cache_t
 {
-  map<array<uint8_t, LUT_UNIT_N>, LExinfoGx_t<N> > aG_Rs;
-  if (N == 4)
+  struct entry_t
   {
-    Peigen::function_t<N> GaF;
-    Peigen::function_t<N> GF;
-    LExinfoGx_t<N>  LExinfo;
-    array<uint8_t, LUT_UNIT_N> R;
-    uint8_t * Rp = R.data();
-    for (int i = 0; i < OPTIMAL_G4_N; i++)
+    bool valid = false;
+    array<uint8_t, LUT_UNIT_N> S;
+    array<uint8_t, LUT_UNIT_N> RS;
+    array<uint8_t, LUT_UNIT_N> A;
+    array<uint8_t, LUT_UNIT_N> B;
+  };
+
+  static size_t size() { return (LE_CACHE_BYTES / sizeof(entry_t)) & ~(size_t)1; }
+
+  vector<entry_t> table;
+  uint64_t hits = 0;
+  uint64_t misses = 0;
+  uint64_t evictions = 0;
+
+  bool holds(size_t k, const uint8_t S[LUT_UNIT_N]) const
+  {
+    return table[k].valid && (memcmp(table[k].S.data(), S, LUT_UNIT_N) == 0);
+  }
+
+  // first slot of the bucket of S
+  static size_t slot(const uint8_t S[LUT_UNIT_N])
+  {
+    uint64_t h = 0;
+    for (int i = 0; i < LUT_UNIT_N; i += 8)
     {
-      LExinfo.Gx = i;
-      GF.LUT[0] = _mm_load_si128((__m128i *)G4[i]);
-      for (int ai = 0; ai < (1 << N); ai++)
+      uint64_t w = 0;
+      memcpy(&w, S + i, (LUT_UNIT_N - i) < 8 ? (LUT_UNIT_N - i) : 8);
+      h = (h ^ w) * 0x9E3779B97F4A7C15ULL;
+    }
+    return ((h ^ (h >> 29)) % (size() / 2)) * 2;
+  }
+
+  bool find(const uint8_t S[LUT_UNIT_N], uint8_t RS[LUT_UNIT_N], uint8_t A[LUT_UNIT_N], uint8_t B[LUT_UNIT_N])
+  {
+    if (size() == 0) return false;
+    size_t k = slot(S);
+    bool found = false;
+    #pragma omp critical (LE_cache)
+    {
+      if (!table.empty() && !holds(k, S)) k++;
+      if (!table.empty() && holds(k, S))
       {
-        LExinfo.c = ai;
-        OPs<N>.composite(GaF.LUT, GF.LUT, XE<N>[ai].LUT);
-        GaF.LE_representative(Rp, LExinfo.L1.data(), LExinfo.L2.data());
-        aG_Rs.insert(pair<array<uint8_t, LUT_UNIT_N>, LExinfoGx_t<N> >(R, LExinfo));
+        memcpy(RS, table[k].RS.data(), LUT_UNIT_N);
+        memcpy(A, table[k].A.data(), LUT_UNIT_N);
+        memcpy(B, table[k].B.data(), LUT_UNIT_N);
+        found = true;
+        hits++;
       }
+      else misses++;
     }
+    return found;
   }
-  return aG_Rs;
-}();
+
+  void insert(const uint8_t S[LUT_UNIT_N], const uint8_t RS[LUT_UNIT_N], const uint8_t A[LUT_UNIT_N], const uint8_t B[LUT_UNIT_N])
+  {
+    if (size() == 0) return;
+    size_t k = slot(S);
+    #pragma omp critical (LE_cache)
+    {
+      if (table.empty()) table.resize(size());
+      if (table[k + 1].valid) evictions++;
+      table[k + 1] = table[k];
+      table[k].valid = true;
+      memcpy(table[k].S.data(), S, LUT_UNIT_N);
+      memcpy(table[k].RS.data(), RS, LUT_UNIT_N);
+      memcpy(table[k].A.data(), A, LUT_UNIT_N);
+      memcpy(table[k].B.data(), B, LUT_UNIT_N);
+    }
+  }
+
+  // the statistics of one run, the cached representatives are kept
+  void reset_stats()
+  {
+    hits = 0;
+    misses = 0;
+    evictions = 0;
+  }
+
+  void print_stats()
+  {
+    uint64_t lookups = hits + misses;
+    if (lookups == 0) return;
+    cout << "LE_representative cache : " << lookups << " lookups, " << hits << " hits ("
+         << fixed << setprecision(1) << (100.0 * hits / lookups) << "%), "
+         << evictions << " evictions" << endl;
+    cout.unsetf(ios::floatfield);
+    cout << setprecision(6);
+  }
+};
+
+template<int N>
+LE_cache_t<N> & LE_cache()
+{
+  static LE_cache_t<N> the_LE_cache;
+  return the_LE_cache;
+}
+
+template<int N>
+const map<array<uint8_t, LUT_UNIT_N>, LExinfoGx_t<N> > & G_Rs()
+{
+  static const map<array<uint8_t, LUT_UNIT_N>, LExinfoGx_t<N> > the_G_Rs = []
+  {
+    map<array<uint8_t, LUT_UNIT_N>, LExinfoGx_t<N> > aG_Rs;
+    if (N == 4)
+    {
+      Peigen::function_t<N> GaF;
+      Peigen::function_t<N> GF;
+      LExinfoGx_t<N>  LExinfo;
+      array<uint8_t, LUT_UNIT_N> R;
+      uint8_t * Rp = R.data();
+      for (int i = 0; i < OPTIMAL_G4_N; i++)
+      {
+        LExinfo.Gx = i;
+        GF.LUT[0] = _mm_load_si128((__m128i *)G4[i]);
+        for (int ai = 0; ai < (1 << N); ai++)
+        {
+          LExinfo.c = ai;
+          OPs<N>.composite(GaF.LUT, GF.LUT, XE<N>()[ai].LUT);
+          GaF.LE_representative_search(Rp, LExinfo.L1.data(), LExinfo.L2.data());
+          aG_Rs.insert(pair<array<uint8_t, LUT_UNIT_N>, LExinfoGx_t<N> >(R, LExinfo));
+        }
+      }
+    }
+    return aG_Rs;
+  }();
+  return the_G_Rs;
+}
+
+// The affine equivalence classes of N-bit permutations known so far, used
+// for N != 4 (the 4-bit ones are the classes G0, ..., G15 of G_Rs<N>()):
+// class i is the one of reps[i], given by function_t<N>::AE_representative().
+// A file of classes has one class per line, "i,<LUT of reps[i]>", the same
+// format as the files of S-boxes. Only load() and insert() modify it, they
+// are not meant to run concurrently with find().
+template<int N>
+struct AE_classes_t
+{
+  vector<array<uint8_t, LUT_UNIT_N> > reps;
+  map<array<uint8_t, LUT_UNIT_N>, int> idx;
+
+  int find(const array<uint8_t, LUT_UNIT_N> & RS) const
+  {
+    auto it = idx.find(RS);
+    return (it != idx.end()) ? (*it).second : -1;
+  }
+
+  // the class of RS, added if new
+  int insert(const array<uint8_t, LUT_UNIT_N> & RS)
+  {
+    int ci = find(RS);
+    if (ci != -1) return ci;
+    idx.insert(pair<array<uint8_t, LUT_UNIT_N>, int>(RS, (int)reps.size()));
+    reps.push_back(RS);
+    return reps.size() - 1;
+  }
+
+  // replaces the classes by those of classesfile (none if it does not exist);
+  // false, with no class loaded, if a line is malformed or out of order
+  bool load(string classesfile)
+  {
+    reps.clear();
+    idx.clear();
+    ifstream fin(classesfile);
+    for(string line; getline(fin, line); )
+    {
+      istringstream instance_line(line);
+      string idx_str;
+      string LUT_str;
+      if(getline(instance_line, idx_str, ',') && getline(instance_line, LUT_str))
+      {
+        Peigen::function_t<N> RF(LUT_str);
+        if ((atoi(idx_str.c_str()) != (int)reps.size()) || !RF.is_permutation())
+        {
+          cout << "Error: " << classesfile << " : expected class " << reps.size()
+               << " as a permutation, got \"" << line << "\"" << endl;
+          reps.clear();
+          idx.clear();
+          return false;
+        }
+        array<uint8_t, LUT_UNIT_N> RS;
+        memcpy(RS.data(), (uint8_t *)RF.LUT, sizeof(uint8_t) * LUT_UNIT_N);
+        insert(RS);
+      }
+    }
+    return true;
+  }
+
+  void save(string classesfile) const
+  {
+    ofstream fout(classesfile.c_str());
+    for (int i = 0; i < (int)reps.size(); i++)
+    {
+      Peigen::function_t<N> RF(reps[i].data());
+      fout << i << "," << RF.LUT_to_string() << endl;
+    }
+  }
+};
+
+template<int N>
+AE_classes_t<N> & AE_classes()
+{
+  static AE_classes_t<N> the_AE_classes;
+  return the_AE_classes;
+}
 
 template<int N>
 void optimalAEclass_split(array<set<Peigen::function_t<N> >,  OPTIMAL_G4_N> & optimalPXEreps)
@@ -44,6 +44,186 @@
 using namespace Peigen;
 using namespace std;
 
+// Intermediates shared by the criteria of one S-box: each one is computed on
+// first use and then served to every criterion that needs it. The context of
+// the inverse S-box takes the DDT and the Walsh spectrum of the forward one,
+// transposed, instead of recomputing them.
+// The tables are 32-byte aligned, keep the context on the stack.
+template<int N>
+struct Peigen::analysis_context
+{
+  const function_t<N> & f;
+  analysis_context<N> * forward;
+
+  bool has_DDT = false;
+  ALIGNED_TYPE_(int, 32) DDT_[LUT_UNIT_N][LUT_UNIT_N];
+  int Diff;
+  int DDT_spectrum[LUT_UNIT_N+1];
+  int Diff1;
+  int DDT1_spectrum[LUT_UNIT_N+1];
+
+  bool has_walsh = false;
+  ALIGNED_TYPE_(int16_t, 32) W_[LUT_UNIT_N][WALSH_YMM_N * 16];
+
+  bool has_products_ANF = false;
+  array<bit_slice_l_t<N>, 1<<N> products_ANF_;
+
+  bool has_components_ANF = false;
+  array<bit_slice_l_t<N>, 1<<N> components_ANF_;
+
+  bool has_inverse = false;
+  function_t<N> inverse_;
+
+  analysis_context(const function_t<N> & af) : f(af), forward(NULL) {}
+
+  // context of af = aforward.inverse(), which only relates to aforward for a permutation
+  analysis_context(const function_t<N> & af, analysis_context<N> & aforward) : f(af), forward(aforward.f.is_permutation() ? &aforward : NULL) {}
+
+  const int (&DDT())[LUT_UNIT_N][LUT_UNIT_N]
+  {
+    if (!has_DDT)
+    {
+      if (forward != NULL)
+      {
+        // DDT_{S^-1}[a][b] = DDT_S[b][a], the spectra are the same
+        const int (&fDDT)[LUT_UNIT_N][LUT_UNIT_N] = forward->DDT();
+        for (int a = 0; a < LUT_UNIT_N; a++)
+          for (int b = 0; b < LUT_UNIT_N; b++)
+            DDT_[a][b] = fDDT[b][a];
+        Diff = forward->Diff;
+        Diff1 = forward->Diff1;
+        memcpy(DDT_spectrum, forward->DDT_spectrum, sizeof(DDT_spectrum));
+        memcpy(DDT1_spectrum, forward->DDT1_spectrum, sizeof(DDT1_spectrum));
+      }
+      else
+      {
+        f.difference_distribution_matrix(DDT_, Diff, DDT_spectrum, Diff1, DDT1_spectrum);
+      }
+      has_DDT = true;
+    }
+    return DDT_;
+  }
+
+  // !!! Only applicable for N = 3, 4, 5, 6, 7, 8
+  const int16_t (&walsh())[LUT_UNIT_N][WALSH_YMM_N * 16]
+  {
+    if (!has_walsh)
+    {
+      if (forward != NULL)
+      {
+        // W_{S^-1}[a][b] = W_S[b][a], the padding columns b >= 2^N stay unused
+        const int16_t (&fW)[LUT_UNIT_N][WALSH_YMM_N * 16] = forward->walsh();
+        for (int a = 0; a < LUT_UNIT_N; a++)
+          for (int b = 0; b < LUT_UNIT_N; b++)
+            W_[a][b] = fW[b][a];
+      }
+      else
+      {
+        f.walsh_spectrum(W_);
+      }
+      has_walsh = true;
+    }
+    return W_;
+  }
+
+  array<bit_slice_l_t<N>, 1<<N> & products_ANF()
+  {
+    if (!has_products_ANF)
+    {
+      f.get_products_ANF(products_ANF_);
+      has_products_ANF = true;
+    }
+    return products_ANF_;
+  }
+
+  // the coordinates are the products S^w of weight 1
+  array<bit_slice_l_t<N>, 1<<N> & components_ANF()
+  {
+    if (!has_components_ANF)
+    {
+      array<bit_slice_l_t<N>, 1<<N> & prod = products_ANF();
+      components_ANF_[0].fill(0);
+      for (int i = 1; i < (1<<N); i++)
+      {
+        components_ANF_[i] = components_ANF_[i & (i - 1)] ^ prod[i & (-i)];
+      }
+      has_components_ANF = true;
+    }
+    return components_ANF_;
+  }
+
+  const function_t<N> & inverse()
+  {
+    if (!has_inverse)
+    {
+      inverse_ = f.inverse();
+      has_inverse = true;
+    }
+    return inverse_;
+  }
+
+  void difference_distribution_matrix(int DDT[LUT_UNIT_N][LUT_UNIT_N], int & aDiff, int aDDT_spectrum[LUT_UNIT_N+1], int & aDiff1, int aDDT1_spectrum[LUT_UNIT_N+1])
+  {
+    memcpy(DDT[0], this->DDT()[0], sizeof(int) * LUT_UNIT_N * LUT_UNIT_N);
+    aDiff = Diff;
+    aDiff1 = Diff1;
+    memcpy(aDDT_spectrum, DDT_spectrum, sizeof(int) * (LUT_UNIT_N+1));
+    memcpy(aDDT1_spectrum, DDT1_spectrum, sizeof(int) * (LUT_UNIT_N+1));
+  }
+
+  void linear_approximation_matrix(int LAT[LUT_UNIT_N][LUT_UNIT_N], int & Lin, int LAT_spectrum[LUT_UNIT_N+1], int & Lin1, int LAT1_spectrum[LUT_UNIT_N+1])
+  {
+    #ifndef NFWHT
+    if (N <= 8)
+    {
+      f.linear_approximation_matrix(LAT, Lin, LAT_spectrum, Lin1, LAT1_spectrum, walsh());
+    }
+    else
+    #endif
+    {
+      f.linear_approximation_matrix(LAT, Lin, LAT_spectrum, Lin1, LAT1_spectrum);
+    }
+  }
+
+  void degree(int deg_spectrum[N+1], int & max_degree, int & min_degree)
+  {
+    // the N = 3, 4 paths also count the zero component in deg_spectrum[0]
+    if (N <= 4) f.degree(deg_spectrum, max_degree, min_degree);
+    else f.degree(deg_spectrum, max_degree, min_degree, components_ANF());
+  }
+
+  void k_product_degree_table(int dkT[N+1])
+  {
+    f.k_product_degree_table(dkT, products_ANF());
+  }
+
+  int number_linear_structures()
+  {
+    ALIGNED_TYPE_(int, 32) ACT[LUT_UNIT_N][LUT_UNIT_N];
+    #ifndef NFWHT
+    if (N <= 8)
+    {
+      f.autocorrelation_matrix(ACT, walsh());
+    }
+    else
+    #endif
+    {
+      f.autocorrelation_matrix(ACT, DDT());
+    }
+    return f.number_linear_structures(ACT);
+  }
+
+  void max_v_w_linear(pair<int, int> & max_v, pair<int, int> & max_w)
+  {
+    f.max_v_w_linear(max_v, max_w);
+  }
+
+  int which_optimal() const
+  {
+    return f.which_optimal();
+  }
+};
+
 template<int N>
 struct Peigen::evaluator
 {
@@ -113,41 +293,81 @@ struct Peigen::evaluator
     is_perm_flag = f.is_permutation();
     is_inv_flag = f.is_involution();
 
-    f.difference_distribution_matrix(DDT, Diff, DDT_spectrum, Diff1, DDT1_spectrum);
+    analysis_context<N> ctx(f);
+
+    ctx.difference_distribution_matrix(DDT, Diff, DDT_spectrum, Diff1, DDT1_spectrum);
     DiffFreq = DDT_spectrum[Diff];  
     CardD1 = N * N - DDT1_spectrum[0];
 
-    f.linear_approximation_matrix(LAT, Lin, LAT_spectrum, Lin1, LAT1_spectrum);
+    ctx.linear_approximation_matrix(LAT, Lin, LAT_spectrum, Lin1, LAT1_spectrum);
     LinFreq = LAT_spectrum[Lin];
     CardL1 = N * N - LAT1_spectrum[0];
 
-    f.degree(deg_spectrum, max_degree, min_degree);
+    ctx.degree(deg_spectrum, max_degree, min_degree);
     max_degree_freq = deg_spectrum[max_degree];
     min_degree_freq = deg_spectrum[min_degree];
 
-    f.k_product_degree_table(dkT);
-    LS_nubmer = f.number_linear_structures();
-    f.max_v_w_linear(max_v, max_w);
+    evaluate_remaining(ctx);
+  }
 
-    whichG = f.which_optimal();
+  // Takes the criteria of the i-th S-box of a batch_evaluator instead of recomputing them,
+  // the DDT, LAT and their spectra are left unfilled
+  evaluator(const function_t<N> & f, const batch_evaluator<N> & batch, int i, string aname = "-", int acost = -1, string acostisBest = "Unknown")
+  {
+    name = aname;
+    cost = (double)acost/100.0;
+    costisBest = acostisBest;
+
+    LUT_str = f.LUT_to_string();
+    bit_slice_str = f.to_string();
+
+    is_perm_flag = batch.is_perm_flag[i];
+    is_inv_flag = batch.is_inv_flag[i];
+
+    Diff = batch.Diff[i];
+    DiffFreq = batch.DiffFreq[i];
+    Diff1 = batch.Diff1[i];
+    CardD1 = batch.CardD1[i];
+
+    Lin = batch.Lin[i];
+    LinFreq = batch.LinFreq[i];
+    Lin1 = batch.Lin1[i];
+    CardL1 = batch.CardL1[i];
+
+    max_degree = batch.max_degree[i];
+    min_degree = batch.min_degree[i];
+    max_degree_freq = batch.max_degree_freq[i];
+    min_degree_freq = batch.min_degree_freq[i];
+
+    analysis_context<N> ctx(f);
+    evaluate_remaining(ctx);
+  }
+
+  void evaluate_remaining(analysis_context<N> & ctx)
+  {
+    ctx.k_product_degree_table(dkT);
+    LS_nubmer = ctx.number_linear_structures();
+    ctx.max_v_w_linear(max_v, max_w);
+
+    whichG = ctx.which_optimal();
 
     if (is_perm_flag)
     {
-      function_t<N> f_inv; 
-      f_inv = f.inverse();
+      const function_t<N> & f_inv = ctx.inverse();
+      analysis_context<N> inv_ctx(f_inv, ctx);
 
       inv_LUT_str = f_inv.LUT_to_string();
       inv_bit_slice_str = f_inv.to_string();
 
-      f_inv.degree(inv_deg_spectrum, inv_max_degree, inv_min_degree);
+      inv_ctx.degree(inv_deg_spectrum, inv_max_degree, inv_min_degree);
       inv_max_degree_freq = inv_deg_spectrum[inv_max_degree];
       inv_min_degree_freq = inv_deg_spectrum[inv_min_degree];
 
-      f_inv.k_product_degree_table(inv_dkT);
-      inv_LS_nubmer = f_inv.number_linear_structures();
-      f_inv.max_v_w_linear(inv_max_v, inv_max_w);
+      inv_ctx.k_product_degree_table(inv_dkT);
+      inv_LS_nubmer = inv_ctx.number_linear_structures();
+      inv_ctx.max_v_w_linear(inv_max_v, inv_max_w);
 
-      inv_whichG = f_inv.which_optimal();
+      inv_whichG = inv_ctx.which_optimal();
     }
   }
 
@@ -256,4 +476,168 @@ struct Peigen::evaluator
   ~evaluator(){};
 };
 
+// Criteria of a batch of S-boxes in structure-of-arrays form.
+// The LUTs are given as one contiguous array of n * LUT_XMM_N __m128i, i.e.
+// the LUT member of n consecutive function_t<N> (for N = 3 the upper 8 bytes are ignored).
+template<int N>
+struct Peigen::batch_evaluator
+{
+  int n;
+
+  vector<uint8_t> is_perm_flag;
+  vector<uint8_t> is_inv_flag;
+
+  vector<int> Diff;
+  vector<int> DiffFreq;
+  vector<int> Diff1;
+  vector<int> CardD1;
+
+  vector<int> Lin;
+  vector<int> LinFreq;
+  vector<int> Lin1;
+  vector<int> CardL1;
+
+  vector<int> max_degree;
+  vector<int> min_degree;
+  vector<int> max_degree_freq;
+  vector<int> min_degree_freq;
+
+  batch_evaluator(const __m128i * LUTs, int an) :
+    n(an),
+    is_perm_flag(an), is_inv_flag(an),
+    Diff(an), DiffFreq(an), Diff1(an), CardD1(an),
+    Lin(an), LinFreq(an), Lin1(an), CardL1(an),
+    max_degree(an), min_degree(an), max_degree_freq(an), min_degree_freq(an)
+  {
+    if (N == 4)
+    {
+      for (int i = 0; i < n; i += 2)
+      {
+        difference_linear_x2(LUTs, i, min(2, n - i));
+      }
+    }
+    else
+    {
+      for (int i = 0; i < n; i++)
+      {
+        difference_linear(function_t<N>((const uint8_t *)(LUTs + i * LUT_XMM_N)), i);
+      }
+    }
+
+    for (int i = 0; i < n; i++)
+    {
+      function_t<N> f((const uint8_t *)(LUTs + i * LUT_XMM_N));
+      int deg_spectrum[N+1];
+      is_perm_flag[i] = f.is_permutation();
+      is_inv_flag[i] = f.is_involution();
+      f.degree(deg_spectrum, max_degree[i], min_degree[i]);
+      max_degree_freq[i] = deg_spectrum[max_degree[i]];
+      min_degree_freq[i] = deg_spectrum[min_degree[i]];
+    }
+  }
+
+  void difference_linear(const function_t<N> & f, int i)
+  {
+    int DDT[LUT_UNIT_N][LUT_UNIT_N];
+    int DDT_spectrum[LUT_UNIT_N+1];
+    int DDT1_spectrum[LUT_UNIT_N+1];
+    int LAT[LUT_UNIT_N][LUT_UNIT_N];
+    int LAT_spectrum[LUT_UNIT_N+1];
+    int LAT1_spectrum[LUT_UNIT_N+1];
+
+    f.difference_distribution_matrix(DDT, Diff[i], DDT_spectrum, Diff1[i], DDT1_spectrum);
+    DiffFreq[i] = DDT_spectrum[Diff[i]];
+    CardD1[i] = N * N - DDT1_spectrum[0];
+
+    f.linear_approximation_matrix(LAT, Lin[i], LAT_spectrum, Lin1[i], LAT1_spectrum);
+    LinFreq[i] = LAT_spectrum[Lin[i]];
+    CardL1[i] = N * N - LAT1_spectrum[0];
+  }
+
+  // !!! Only applicable for N = 4
+  // Two 4-bit S-boxes per __m256i, one in each 128-bit lane;
+  // the counters of lane k are the popcounts of bits [16k, 16k+16) of the movemask.
+  void difference_linear_x2(const __m128i * LUTs, int i, int lanes)
+  {
+    const __m256i S = (lanes == 2) ? _mm256_loadu_si256((const __m256i *)(LUTs + i)) : _mm256_broadcastsi128_si256(LUTs[i]);
+    const __m256i X = _mm256_broadcastsi128_si256(x);
+
+    // DDT[0][.] and LAT[.][0] are left to 0, the trivial entry [0][0] is added back afterwards
+    uint8_t ALIGNED_(32) DDT[2][LUT_UNIT_N][LUT_UNIT_N] = {{{0}}};
+    uint8_t ALIGNED_(32) LAT[2][LUT_UNIT_N][LUT_UNIT_N] = {{{0}}};
+
+    for (int id = 1; id < LUT_UNIT_N; id++)
+    {
+      const __m256i t = _mm256_xor_si256(S, _mm256_shuffle_epi8(S, _mm256_xor_si256(X, _mm256_set1_epi8(id))));
+      for (int od = 0; od < LUT_UNIT_N; od++)
+      {
+        uint32_t m = _mm256_movemask_epi8(_mm256_cmpeq_epi8(t, _mm256_set1_epi8(od)));
+        DDT[0][id][od] = _mm_popcnt_u32(m & 0xffff);
+        DDT[1][id][od] = _mm_popcnt_u32(m >> 16);
+      }
+    }
+
+    for (int im = 0; im < LUT_UNIT_N; im++)
+    {
+      const __m256i t1 = _mm256_and_si256(X, _mm256_set1_epi8(im));
+      for (int om = 1; om < LUT_UNIT_N; om++)
+      {
+        // parity of the low nibble ends up in the most significant bit of each byte
+        __m256i t2 = _mm256_xor_si256(_mm256_and_si256(S, _mm256_set1_epi8(om)), t1);
+        t2 = _mm256_xor_si256(_mm256_slli_epi16(t2, 4), _mm256_slli_epi16(t2, 5));
+        t2 = _mm256_xor_si256(t2, _mm256_slli_epi16(t2, 2));
+        uint32_t m = _mm256_movemask_epi8(t2);
+        LAT[0][im][om] = 2 * abs((int)_mm_popcnt_u32(m & 0xffff) - 8);
+        LAT[1][im][om] = 2 * abs((int)_mm_popcnt_u32(m >> 16) - 8);
+      }
+    }
+
+    for (int k = 0; k < lanes; k++)
+    {
+      max_freq(DDT[k], Diff[i + k], DiffFreq[i + k]);
+      max_freq(LAT[k], Lin[i + k], LinFreq[i + k]);
+      DiffFreq[i + k] += (Diff[i + k] == LUT_UNIT_N);
+      LinFreq[i + k] += (Lin[i + k] == LUT_UNIT_N);
+
+      Diff1[i + k] = 0;
+      CardD1[i + k] = 0;
+      Lin1[i + k] = 0;
+      CardL1[i + k] = 0;
+      for (int a = 0; a < N; a++)
+      {
+        for (int b = 0; b < N; b++)
+        {
+          int d = DDT[k][1 << a][1 << b];
+          int l = LAT[k][1 << a][1 << b];
+          Diff1[i + k] = max(Diff1[i + k], d);
+          CardD1[i + k] += (d != 0);
+          Lin1[i + k] = max(Lin1[i + k], l);
+          CardL1[i + k] += (l != 0);
+        }
+      }
+    }
+  }
+
+  // !!! Only applicable for N = 4
+  // Maximum of the 256 counters of T and its number of occurrences
+  static void max_freq(const uint8_t T[LUT_UNIT_N][LUT_UNIT_N], int & M, int & F)
+  {
+    const __m256i * Tp = (const __m256i *)T[0];
+    __m256i m = Tp[0];
+    for (int j = 1; j < 8; j++) m = _mm256_max_epu8(m, Tp[j]);
+    __m128i m128 = _mm_max_epu8(_mm256_castsi256_si128(m), _mm256_extracti128_si256(m, 1));
+    m128 = _mm_max_epu8(m128, _mm_srli_si128(m128, 8));
+    m128 = _mm_max_epu8(m128, _mm_srli_si128(m128, 4));
+    m128 = _mm_max_epu8(m128, _mm_srli_si128(m128, 2));
+    m128 = _mm_max_epu8(m128, _mm_srli_si128(m128, 1));
+    M = _mm_extract_epi8(m128, 0);
+
+    const __m256i Mv = _mm256_set1_epi8(M);
+    F = 0;
+    for (int j = 0; j < 8; j++) F += _mm_popcnt_u32(_mm256_movemask_epi8(_mm256_cmpeq_epi8(Tp[j], Mv)));
+  }
+
+  ~batch_evaluator(){};
+};
+
 #endif // EVALUATOR_H__
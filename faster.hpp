@@ -39,6 +39,7 @@
 #define FASTER_H__
 
 #include "faster_func.hpp"
+#include "faster_graphe.hpp"
 
 using namespace Peigen::depth;
 using namespace std;
@@ -57,7 +58,9 @@ public:
     int max_GE = 0;
     vector<bool_op_t> b; // The boolean instructions (B in the paper)
 
-    map<int, set<bool_function_t<N>> > f1_succ;
+    graphe_t<N> f1_succ;
+    // per expanded layer, the number of generated successors and the number kept in the graph
+    map<int, pair<uint64_t, uint64_t> > succ_stats;
     
     function_t<N> start;
     function_t<N> target;
@@ -67,7 +70,7 @@ public:
     int count_list;
     int shortest_path = MAX_COST;
     int smallest_area = MAX_COST;
-    set<const bool_function_t<N>* > area_sum;
+    set<uint32_t> area_sum;
 
     bool verbose = false;
     int l = 1200;
@@ -157,6 +160,7 @@ public:
       max_GE = 0;
       b.clear();
       f1_succ.clear();
+      succ_stats.clear();
       shortest_path = MAX_COST;
       smallest_area = MAX_COST;
       area_sum.clear();
@@ -205,11 +209,13 @@ public:
 
     void init_b(string conf_file);
 
-    void bool_op_one_input(const bool_function_t<N> *f, vector<bool_function_t<N> > *v, bool_op_t bool_op);
+    void bool_op_one_input(uint32_t f, successor_list_t<N> *v, bool_op_t bool_op);
 
-    void bool_op_two_inputs(const bool_function_t<N> *f1, const bool_function_t<N> *f2, vector<bool_function_t<N> > *v, bool_op_t bool_op);
+    void bool_op_block(int operation, const bit_slice_l_t<N> & s1, const bool_function_t<N> * g2, int n, bool reverse, bit_slice_l_t<N> * res);
 
-    void bool_op_three_inputs(const bool_function_t<N> *f1, const bool_function_t<N> *f2, const bool_function_t<N> *f3, vector<bool_function_t<N> > *v, bool_op_t bool_op);
+    void bool_op_two_inputs(uint32_t f1, uint32_t f2_first, uint32_t f2_last, bool reverse, successor_list_t<N> *v, bool_op_t bool_op);
+
+    void bool_op_three_inputs(uint32_t f1, uint32_t f2, uint32_t f3_first, uint32_t f3_last, successor_list_t<N> *v, bool_op_t bool_op);
 
     string get_implementation(bool_function_t<N> f1);
 
@@ -219,7 +225,7 @@ public:
 
     void exit_m();
 
-    void graphe_to_file(map<int, set<bool_function_t<N> > > *graphe,
+    void graphe_to_file(graphe_t<N> *graphe,
                     string graphe_name);
     
     void print_uint16(uint16_t n);
@@ -232,6 +238,12 @@ public:
 
     void mitm(function_t<N> f1);
 
+    static bool successor_less(const bool_function_t<N> & f, const bool_function_t<N> & g);
+
+    void expand_node(uint32_t f1, bool_op_t bool_op, successor_list_t<N> & succ);
+
+    void merge_successors(vector<vector<bool_function_t<N> > > & lists, vector<bool_function_t<N> > & merged);
+
     void expand(int lambda);
 
     void v_list_process(int lambda, int op_cost, vector<bool_function_t<N> > *tmp,
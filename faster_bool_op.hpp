@@ -41,6 +41,11 @@
 using namespace std;
 using namespace Peigen::depth;
 
+// number of partner functions a gate is applied to per iteration of the successor generation
+#ifndef BOOL_OP_BLOCK_N
+#define BOOL_OP_BLOCK_N 8
+#endif
+
 template<int N>
 void faster<N>::all_gates()
 {
@@ -201,73 +206,154 @@ void faster<N>::init_b(string conf_file)
 }
 
 template<int N>
-void faster<N>::bool_op_one_input(const bool_function_t<N> *f, vector<bool_function_t<N> > *v, bool_op_t bool_op)
+void faster<N>::bool_op_one_input(uint32_t f, successor_list_t<N> *v, bool_op_t bool_op)
 {
   int operation = bool_op.op_id;
   int cost = bool_op.op_cost;
+  const bool_function_t<N> & g = f1_succ.node(f);
 
   bool_function_t<N> fun_tmp;
 
   if (operation == NOT1)
   {
-    fun_tmp.bit_slice = ~((*f).bit_slice);
-    fun_tmp.area = (*f).area + cost;    
+    fun_tmp.bit_slice = ~(g.bit_slice);
+    fun_tmp.area = g.area + cost;    
     fun_tmp.info_op = (uint8_t)operation;
     fun_tmp.operands[0] = f;
-    v->push_back(fun_tmp);
+    v->push_back(fun_tmp, successor_less);
+  }
+}
+
+/*
+  The bit slices of a block of n successors: the gate is applied to s1 and to
+  each of the n consecutive nodes g2, s1 being the first operand (the second
+  one if reverse). For N = 8 a bit slice is one __m256i.
+*/
+template<int N>
+void faster<N>::bool_op_block(int operation, const bit_slice_l_t<N> & s1, const bool_function_t<N> * g2, int n, bool reverse, bit_slice_l_t<N> * res)
+{
+  if (BIT_SLICE_BITS_N == 256)
+  {
+    const __m256i ones = _mm256_set1_epi8(-1);
+    const __m256i a = _mm256_loadu_si256((const __m256i *)s1.data());
+    auto block = [&](auto gate)
+    {
+      for (int i = 0; i < n; i++)
+      {
+        __m256i b = _mm256_loadu_si256((const __m256i *)g2[i].bit_slice.data());
+        _mm256_store_si256((__m256i *)res[i].data(), gate(b));
+      }
+    };
+    switch(operation)
+    {
+      case AND2  : block([&](__m256i b) { return _mm256_and_si256(a, b); }); break;
+      case OR2   : block([&](__m256i b) { return _mm256_or_si256(a, b); }); break;
+      case NAND2 : block([&](__m256i b) { return _mm256_xor_si256(_mm256_and_si256(a, b), ones); }); break;
+      case NOR2  : block([&](__m256i b) { return _mm256_xor_si256(_mm256_or_si256(a, b), ones); }); break;
+      case ANDN2 : if (reverse) block([&](__m256i b) { return _mm256_andnot_si256(b, a); });
+                   else         block([&](__m256i b) { return _mm256_andnot_si256(a, b); });
+                   break;
+      case ORN2  : if (reverse) block([&](__m256i b) { return _mm256_xor_si256(_mm256_andnot_si256(a, b), ones); });
+                   else         block([&](__m256i b) { return _mm256_xor_si256(_mm256_andnot_si256(b, a), ones); });
+                   break;
+      case MAOI1 :
+      case XOR2  : block([&](__m256i b) { return _mm256_xor_si256(a, b); }); break;
+      case MOAI1 :
+      case XNOR2 : block([&](__m256i b) { return _mm256_xor_si256(_mm256_xor_si256(a, b), ones); }); break;
+    }
+  }
+  else
+  {
+    const bit_slice_l_t<N> & a = s1;
+    auto block = [&](auto gate)
+    {
+      for (int i = 0; i < n; i++) res[i] = gate(g2[i].bit_slice);
+    };
+    switch(operation)
+    {
+      case AND2  : block([&](const bit_slice_l_t<N> & b) { return   a & b ; }); break;
+      case OR2   : block([&](const bit_slice_l_t<N> & b) { return   a | b ; }); break;
+      case NAND2 : block([&](const bit_slice_l_t<N> & b) { return ~(a & b); }); break;
+      case NOR2  : block([&](const bit_slice_l_t<N> & b) { return ~(a | b); }); break;
+      case ANDN2 : if (reverse) block([&](const bit_slice_l_t<N> & b) { return (~b) & a; });
+                   else         block([&](const bit_slice_l_t<N> & b) { return (~a) & b; });
+                   break;
+      case ORN2  : if (reverse) block([&](const bit_slice_l_t<N> & b) { return (~b) | a; });
+                   else         block([&](const bit_slice_l_t<N> & b) { return (~a) | b; });
+                   break;
+      case MAOI1 :
+      case XOR2  : block([&](const bit_slice_l_t<N> & b) { return   a ^ b ; }); break;
+      case MOAI1 :
+      case XNOR2 : block([&](const bit_slice_l_t<N> & b) { return ~(a ^ b); }); break;
+    }
   }
 }
 
 template<int N>
-void faster<N>::bool_op_two_inputs(const bool_function_t<N> *f1, const bool_function_t<N> *f2, vector<bool_function_t<N> > *v, bool_op_t bool_op)
+void faster<N>::bool_op_two_inputs(uint32_t f1, uint32_t f2_first, uint32_t f2_last, bool reverse, successor_list_t<N> *v, bool_op_t bool_op)
 {
   int operation = bool_op.op_id;
   int cost = bool_op.op_cost;
+  const bool_function_t<N> & g1 = f1_succ.node(f1);
 
-  bool_function_t<N> fun_tmp;
+  alignas(32) bit_slice_l_t<N> bit_slices[BOOL_OP_BLOCK_N];
 
-  switch(operation)
+  for (uint32_t f2 = f2_first; f2 < f2_last; f2 += BOOL_OP_BLOCK_N)
   {
-    case AND2  : fun_tmp.bit_slice =    (*f1).bit_slice & (*f2).bit_slice ; break;
-    case OR2   : fun_tmp.bit_slice =    (*f1).bit_slice | (*f2).bit_slice ; break;
-    case NAND2 : fun_tmp.bit_slice =  ~((*f1).bit_slice & (*f2).bit_slice); break;
-    case NOR2  : fun_tmp.bit_slice =  ~((*f1).bit_slice | (*f2).bit_slice); break;
-    case ANDN2 : fun_tmp.bit_slice = (~(*f1).bit_slice) & (*f2).bit_slice ; break;
-    case ORN2  : fun_tmp.bit_slice = (~(*f1).bit_slice) | (*f2).bit_slice ; break;
-    case MAOI1 :
-    case XOR2  : fun_tmp.bit_slice =   (*f1).bit_slice ^ (*f2).bit_slice ; break;
-    case MOAI1 :
-    case XNOR2 : fun_tmp.bit_slice = ~((*f1).bit_slice ^ (*f2).bit_slice); break;
+    int n = min<uint32_t>(BOOL_OP_BLOCK_N, f2_last - f2);
+    const bool_function_t<N> * g2 = &(f1_succ.node(f2));
+    bool_op_block(operation, g1.bit_slice, g2, n, reverse, bit_slices);
+
+    for (int i = 0; i < n; i++)
+    {
+      bool_function_t<N> fun_tmp(bit_slices[i]);
+      fun_tmp.area = g1.area + g2[i].area + cost;
+      fun_tmp.info_op = (uint8_t)operation;
+      fun_tmp.operands[0] = reverse ? f2 + i : f1;
+      fun_tmp.operands[1] = reverse ? f1 : f2 + i;
+      v->push_back(fun_tmp, successor_less);
+    }
   }
-  fun_tmp.area = (*f1).area + (*f2).area + cost;
-  fun_tmp.info_op = (uint8_t)operation;
-  fun_tmp.operands[0] = f1;
-  fun_tmp.operands[1] = f2;
-  v->push_back(fun_tmp);
 }
 
 template<int N>
-void faster<N>::bool_op_three_inputs(const bool_function_t<N> *f1, const bool_function_t<N> *f2, const bool_function_t<N> *f3, vector<bool_function_t<N> > *v, bool_op_t bool_op)
+void faster<N>::bool_op_three_inputs(uint32_t f1, uint32_t f2, uint32_t f3_first, uint32_t f3_last, successor_list_t<N> *v, bool_op_t bool_op)
 {
   int operation = bool_op.op_id;
   int cost = bool_op.op_cost;
+  const bool_function_t<N> & g1 = f1_succ.node(f1);
+  const bool_function_t<N> & g2 = f1_succ.node(f2);
 
-  bool_function_t<N> fun_tmp;
-
+  // the 3-input gate is the 2-input one applied to (f1 . f2) and f3
+  bit_slice_l_t<N> s12;
+  int operation2 = NOP;
   switch(operation)
   {
-    case AND3  : fun_tmp.bit_slice =   (*f1).bit_slice & (*f2).bit_slice & (*f3).bit_slice; break;
-    case OR3   : fun_tmp.bit_slice =   (*f1).bit_slice | (*f2).bit_slice | (*f3).bit_slice; break;
-    case NAND3 : fun_tmp.bit_slice = ~((*f1).bit_slice & (*f2).bit_slice & (*f3).bit_slice); break;
-    case NOR3  : fun_tmp.bit_slice = ~((*f1).bit_slice | (*f2).bit_slice | (*f3).bit_slice); break;
+    case AND3  : s12 = g1.bit_slice & g2.bit_slice; operation2 = AND2 ; break;
+    case OR3   : s12 = g1.bit_slice | g2.bit_slice; operation2 = OR2  ; break;
+    case NAND3 : s12 = g1.bit_slice & g2.bit_slice; operation2 = NAND2; break;
+    case NOR3  : s12 = g1.bit_slice | g2.bit_slice; operation2 = NOR2 ; break;
   }
 
-  fun_tmp.area = (*f1).area + (*f2).area + (*f3).area + cost;
-  fun_tmp.info_op = (uint8_t)operation;
-  fun_tmp.operands[0] = f1;
-  fun_tmp.operands[1] = f2;
-  fun_tmp.operands[2] = f3;
-  v->push_back(fun_tmp);
+  alignas(32) bit_slice_l_t<N> bit_slices[BOOL_OP_BLOCK_N];
+
+  for (uint32_t f3 = f3_first; f3 < f3_last; f3 += BOOL_OP_BLOCK_N)
+  {
+    int n = min<uint32_t>(BOOL_OP_BLOCK_N, f3_last - f3);
+    const bool_function_t<N> * g3 = &(f1_succ.node(f3));
+    bool_op_block(operation2, s12, g3, n, false, bit_slices);
+
+    for (int i = 0; i < n; i++)
+    {
+      bool_function_t<N> fun_tmp(bit_slices[i]);
+      fun_tmp.area = g1.area + g2.area + g3[i].area + cost;
+      fun_tmp.info_op = (uint8_t)operation;
+      fun_tmp.operands[0] = f1;
+      fun_tmp.operands[1] = f2;
+      fun_tmp.operands[2] = f3 + i;
+      v->push_back(fun_tmp, successor_less);
+    }
+  }
 }
 
 #endif // #ifndef FASTER_BOOL_OP_H__
\ No newline at end of file
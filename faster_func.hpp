@@ -79,15 +79,18 @@ struct Peigen::depth::bool_function_t
 
   int area = 0;
 
-  const bool_function_t<N> * operands[3];
+  /*
+    the indices of the operands in the graph
+  */
+  uint32_t operands[3];
 
   bool_function_t()
   {
     info_op = NOP;
     area = 0;
-    operands[0] = NULL;
-    operands[1] = NULL;
-    operands[2] = NULL;
+    operands[0] = 0;
+    operands[1] = 0;
+    operands[2] = 0;
   };
 
   bool_function_t(const bit_slice_l_t<N> a)
@@ -95,19 +98,9 @@ struct Peigen::depth::bool_function_t
     bit_slice = a;
     info_op = NOP;
     area = 0;
-    operands[0] = NULL;
-    operands[1] = NULL;
-    operands[2] = NULL;
-  }
-
-  bool_function_t(const bool_function_t& f)
-  {
-    bit_slice = f.bit_slice;
-    info_op = f.info_op;
-    area = f.area;
-    operands[0] = f.operands[0];
-    operands[1] = f.operands[1];
-    operands[2] = f.operands[2]; 
+    operands[0] = 0;
+    operands[1] = 0;
+    operands[2] = 0;
   }
 
   bool operator < (const bool_function_t& f) const
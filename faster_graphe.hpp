@@ -0,0 +1,579 @@
+/**
+ * PEIGEN: a Platform for Evaluation, Implementation, and Generation of S-boxes
+ *
+ *  Copyright 2019 by
+ *    Zhenzhen Bao <baozhenzhen10[at]gmail.com>
+ *    Jian Guo <guojian[at]ntu.edu.sg>
+ *    San Ling <lingsan[at]ntu.edu.sg>
+ *    Yu Sasaki <yu[dot]sasaki[dot]sk@hco.ntt.co.jp>
+ * 
+ * This platform is developed based on the open source application
+ * <http://jeremy.jean.free.fr/pub/fse2018_layer_implementations.tar.gz>
+ * Optimizing Implementations of Lightweight Building Blocks
+ *
+ *  Copyright 2017 by
+ *    Jade Tourteaux <Jade[dot]Tourteaux[at]gmail.com>
+ *    Jérémy Jean <Jean[dot]Jeremy[at]gmail.com>
+ * 
+ * We follow the same copyright policy.
+ * 
+ * This file is part of some open source application.
+ * 
+ * Some open source application is free software: you can redistribute 
+ * it and/or modify it under the terms of the GNU General Public 
+ * License as published by the Free Software Foundation, either 
+ * version 3 of the License, or (at your option) any later version.
+ * 
+ * Some open source application is distributed in the hope that it will 
+ * be useful, but WITHOUT ANY WARRANTY; without even the implied warranty 
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Foobar.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @license GPL-3.0+ <http://spdx.org/licenses/GPL-3.0+>
+ */
+
+#ifndef FASTER_GRAPHE_H__
+#define FASTER_GRAPHE_H__
+
+#include "faster_func.hpp"
+
+using namespace Peigen::depth;
+using namespace std;
+
+#define DEPTH_GRAPHE_TABLE_INIT_N (1 << 10)
+
+/*
+  Layout of a pre_*.bin file of the depth search (one file per depth layer):
+    pre_bin_depth_header_t
+    count bool_function_t records sorted by bit slice
+  The operands of the records are node indices. The layers are read in
+  increasing depth, an expanded layer takes the indices [base, base + count),
+  so the records are read as they are. The operands of a layer are below base.
+  Files without the header are in the former format, where every operand
+  is written as its depth and its bit slice.
+*/
+#define DEPTH_PRE_BIN_MAGIC "PEIGENPD"
+#define DEPTH_PRE_BIN_VERSION 1
+
+struct pre_bin_depth_header_t
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t n;
+  uint32_t record_size;
+  int32_t depth;
+  uint32_t expanded;
+  uint32_t base;
+  uint64_t count;
+};
+
+/*
+  The depth-layered graph of the depth search.
+  The layers which have been expanded (frozen) are contiguous ranges of one
+  array of nodes, in increasing depth and each sorted by bit slice; the
+  operands of a node are indices in this array (every operand is in an
+  expanded layer), so the graph can be written and read as it is.
+  The other layers are pending: their nodes are kept in insertion order until
+  the layer is frozen before its expansion. A node is replaced when the same
+  function is inserted at a smaller depth, or at the same depth with a
+  smaller area; only pending nodes can be replaced (a replaced node in
+  another layer is left dead until the layer is compacted).
+  An open-addressing table (linear probing) over the bit slices maps a
+  function to its node, so that the membership and dominance tests are a
+  single probe.
+*/
+template<int N>
+class Peigen::depth::graphe_t
+{
+public:
+    struct layer_t
+    {
+      int depth = 0;
+      bool frozen = false;
+      uint32_t begin = 0; // the nodes [begin, end) of a frozen layer
+      uint32_t end = 0;
+      vector<bool_function_t<N> > pending;
+      bool sorted = true;
+      size_t size = 0;
+    };
+
+    struct range_t
+    {
+      const bool_function_t<N> * first;
+      const bool_function_t<N> * last;
+
+      const bool_function_t<N> * begin() const { return first; }
+      const bool_function_t<N> * end() const { return last; }
+      size_t size() const { return last - first; }
+    };
+
+    map<int, layer_t> layers;
+
+    graphe_t() { clear(); };
+
+    graphe_t(const graphe_t &) = delete;
+
+    graphe_t & operator = (const graphe_t &) = delete;
+
+    void clear()
+    {
+      nodes.clear();
+      nodes.shrink_to_fit();
+      layers.clear();
+      live_n = 0;
+      table.assign(DEPTH_GRAPHE_TABLE_INIT_N, entry_t());
+      mask = DEPTH_GRAPHE_TABLE_INIT_N - 1;
+      table_n = 0;
+    }
+
+    size_t size() const
+    {
+      return live_n;
+    }
+
+    // number of nodes in the frozen layers, the indices of the nodes are below
+    uint32_t frozen_n() const
+    {
+      return nodes.size();
+    }
+
+    const bool_function_t<N> & node(uint32_t i) const
+    {
+      return nodes[i];
+    }
+
+    // the node of bit_slice and its layer, NULL if it is not in the graph
+    const bool_function_t<N> * find(const bit_slice_l_t<N> & bit_slice, const layer_t ** layer = NULL) const
+    {
+      const entry_t & e = table[slot(bit_slice)];
+      if (e.layer == NULL) return NULL;
+      if (layer != NULL) *layer = e.layer;
+      return &(node_of(e));
+    }
+
+    // index of the node of bit_slice, -1 if it is not in a frozen layer
+    long index(const bit_slice_l_t<N> & bit_slice) const
+    {
+      const entry_t & e = table[slot(bit_slice)];
+      return ((e.layer == NULL) || !e.layer->frozen) ? -1 : (long)e.i;
+    }
+
+    void insert(int c, const bool_function_t<N> & f)
+    {
+      insert(c, &f, &f + 1);
+    }
+
+    // Insert the functions of [first, last) at depth c; the layer c is created even if the range is empty.
+    template<class It>
+    void insert(int c, It first, It last)
+    {
+      layer_t & ly = layer_at(c);
+      if (ly.frozen) return;
+      for (auto it = first; it != last; it++)
+      {
+        const bool_function_t<N> & f = *it;
+        size_t pos = slot(f.bit_slice);
+        if (table[pos].layer != NULL)
+        {
+          layer_t * old = table[pos].layer;
+          if (old->frozen) continue;
+          bool_function_t<N> & g = old->pending[table[pos].i];
+          if ((old->depth < c) || ((old->depth == c) && (g.area <= f.area))) continue;
+          if (old == &ly)
+          {
+            g = f;
+            continue;
+          }
+          g.info_op = DEAD_OP;
+          old->size--;
+          live_n--;
+        }
+        else if (2 * (table_n + 1) > table.size())
+        {
+          // keep the load factor below 1/2
+          rehash(2 * table.size());
+          pos = slot(f.bit_slice);
+        }
+        if (!ly.pending.empty() && !(ly.pending.back().bit_slice < f.bit_slice)) ly.sorted = false;
+        if (table[pos].layer == NULL) table_n++;
+        table[pos].layer = &ly;
+        table[pos].i = ly.pending.size();
+        ly.pending.push_back(f);
+        ly.size++;
+        live_n++;
+      }
+    }
+
+    // Freeze the layers of depth at most lambda, before the expansion of lambda
+    void freeze(int lambda)
+    {
+      for (auto & ly : layers)
+      {
+        if (ly.first > lambda) break;
+        if (!ly.second.frozen) freeze(ly.second);
+      }
+    }
+
+    // the nodes of the layer c sorted by bit slice, empty if there is no layer c
+    range_t layer(int c)
+    {
+      auto it = layers.find(c);
+      if (it == layers.end()) return range_t{NULL, NULL};
+      layer_t & ly = it->second;
+      if (ly.frozen) return range_t{nodes.data() + ly.begin, nodes.data() + ly.end};
+      compact(ly);
+      return range_t{ly.pending.data(), ly.pending.data() + ly.pending.size()};
+    }
+
+    // a sorted copy of the layer c, which leaves the graph untouched (it may be read concurrently)
+    vector<bool_function_t<N> > layer_copy(int c) const
+    {
+      vector<bool_function_t<N> > res;
+      auto it = layers.find(c);
+      if (it == layers.end()) return res;
+      const layer_t & ly = it->second;
+      if (ly.frozen) return vector<bool_function_t<N> >(nodes.begin() + ly.begin, nodes.begin() + ly.end);
+      for (auto & f : ly.pending)
+      {
+        if (f.info_op != DEAD_OP) res.push_back(f);
+      }
+      std::sort(res.begin(), res.end());
+      return res;
+    }
+
+    bool write_layer(int c, string fn)
+    {
+      range_t nodes_c = layer(c);
+      const layer_t & ly = layers[c];
+
+      pre_bin_depth_header_t header;
+      memset(&header, 0, sizeof(header));
+      memcpy(header.magic, DEPTH_PRE_BIN_MAGIC, 8);
+      header.version = DEPTH_PRE_BIN_VERSION;
+      header.n = N;
+      header.record_size = sizeof(bool_function_t<N>);
+      header.depth = c;
+      header.expanded = ly.frozen;
+      header.base = ly.frozen ? ly.begin : frozen_n();
+      header.count = nodes_c.size();
+
+      ofstream fout(fn, ios::binary);
+      fout.write((char *)&header, sizeof(header));
+      fout.write((char *)nodes_c.begin(), header.count * header.record_size);
+      fout.close();
+      if (!fout)
+      {
+        cout << "Error: failed to write " << fn << endl;
+        return false;
+      }
+      return true;
+    }
+
+    // Read the file fn as the layer c.
+    // Return 1 if read, 0 if fn does not exist, -1 if it cannot be used with this graph.
+    // expanded tells whether a file of the former format is an expanded layer.
+    int read_layer(int c, string fn, bool expanded)
+    {
+      ifstream fin(fn, ios::binary);
+      if (!fin) return 0;
+
+      pre_bin_depth_header_t header;
+      if (!fin.read((char *)&header, sizeof(header)) || (memcmp(header.magic, DEPTH_PRE_BIN_MAGIC, 8) != 0))
+      {
+        fin.close();
+        return read_former_layer(c, fn, expanded);
+      }
+
+      if ((header.version != DEPTH_PRE_BIN_VERSION) || (header.n != N) ||
+          (header.record_size != sizeof(bool_function_t<N>)) || (header.depth != c) ||
+          (header.expanded ? (header.base != frozen_n()) : (header.base > frozen_n())) ||
+          (layers.find(c) != layers.end()))
+      {
+        cout << "Error: " << fn << " cannot be read (version " << header.version << ", N = " << header.n << ")" << endl;
+        return -1;
+      }
+
+      layer_t & ly = layer_at(c);
+      bool_function_t<N> * recs;
+      if (header.expanded)
+      {
+        ly.frozen = true;
+        ly.begin = frozen_n();
+        ly.end = ly.begin + header.count;
+        nodes.resize(ly.end);
+        recs = nodes.data() + ly.begin;
+      }
+      else
+      {
+        ly.pending.resize(header.count);
+        recs = ly.pending.data();
+      }
+      if (!fin.read((char *)recs, header.count * header.record_size))
+      {
+        cout << "Error: " << fn << " is truncated" << endl;
+        return -1;
+      }
+
+      if (2 * (table_n + header.count) > table.size())
+      {
+        size_t table_size = table.size();
+        while (2 * (table_n + header.count) > table_size) table_size <<= 1;
+        rehash(table_size);
+      }
+      for (uint32_t i = 0; i < header.count; i++)
+      {
+        size_t pos = slot(recs[i].bit_slice);
+        if (table[pos].layer != NULL)
+        {
+          // the operands are node indices, a record cannot be dropped in favour of another
+          cout << "Error: " << fn << " has the bit slice of node " << i << " twice or in another layer" << endl;
+          return -1;
+        }
+        table_n++;
+        table[pos].layer = &ly;
+        table[pos].i = ly.frozen ? ly.begin + i : i;
+      }
+      ly.size = header.count;
+      live_n += header.count;
+      return 1;
+    }
+
+    // hash of a bit slice for the open-addressing tables
+    static size_t hash(const bit_slice_l_t<N> & bit_slice)
+    {
+      uint64_t h = 0;
+      for (int j = 0; j < UNIT_N; j++)
+      {
+        h = (h ^ (uint64_t)bit_slice[j]) * 0x9E3779B97F4A7C15ULL;
+      }
+      return h ^ (h >> 29);
+    }
+
+private:
+    static constexpr uint8_t DEAD_OP = 0xff;
+
+    struct entry_t
+    {
+      layer_t * layer = NULL; // NULL for an empty slot
+      uint32_t i = 0;         // the node index in a frozen layer, otherwise the position in pending
+    };
+
+    vector<bool_function_t<N> > nodes;
+    size_t live_n;
+
+    vector<entry_t> table;
+    size_t mask;
+    size_t table_n;
+
+    const bool_function_t<N> & node_of(const entry_t & e) const
+    {
+      return e.layer->frozen ? nodes[e.i] : e.layer->pending[e.i];
+    }
+
+    // the slot of bit_slice, or the empty slot where it would be placed
+    size_t slot(const bit_slice_l_t<N> & bit_slice) const
+    {
+      size_t pos = hash(bit_slice) & mask;
+      while ((table[pos].layer != NULL) && (node_of(table[pos]).bit_slice != bit_slice))
+      {
+        pos = (pos + 1) & mask;
+      }
+      return pos;
+    }
+
+    void rehash(size_t table_size)
+    {
+      vector<entry_t> old_table(table_size);
+      old_table.swap(table);
+      mask = table_size - 1;
+      for (auto & e : old_table)
+      {
+        if (e.layer == NULL) continue;
+        size_t pos = hash(node_of(e).bit_slice) & mask;
+        while (table[pos].layer != NULL) pos = (pos + 1) & mask;
+        table[pos] = e;
+      }
+    }
+
+    layer_t & layer_at(int c)
+    {
+      auto it = layers.find(c);
+      if (it == layers.end())
+      {
+        it = layers.insert(make_pair(c, layer_t())).first;
+        it->second.depth = c;
+      }
+      return it->second;
+    }
+
+    // Drop the dead nodes of a pending layer and sort it by bit slice
+    void compact(layer_t & ly)
+    {
+      if (ly.sorted && (ly.size == ly.pending.size())) return;
+
+      // the slots are found before the nodes move
+      vector<pair<bool_function_t<N>, size_t> > live;
+      live.reserve(ly.size);
+      for (auto & f : ly.pending)
+      {
+        if (f.info_op != DEAD_OP) live.push_back(make_pair(f, slot(f.bit_slice)));
+      }
+      std::sort(live.begin(), live.end(), [](const pair<bool_function_t<N>, size_t> & a, const pair<bool_function_t<N>, size_t> & b) { return a.first < b.first; });
+
+      ly.pending.clear();
+      for (uint32_t i = 0; i < live.size(); i++)
+      {
+        ly.pending.push_back(live[i].first);
+        table[live[i].second].i = i;
+      }
+      ly.sorted = true;
+    }
+
+    void freeze(layer_t & ly)
+    {
+      compact(ly);
+
+      vector<size_t> slots(ly.pending.size());
+      for (uint32_t i = 0; i < ly.pending.size(); i++) slots[i] = slot(ly.pending[i].bit_slice);
+
+      if (nodes.size() + ly.pending.size() > numeric_limits<uint32_t>::max())
+      {
+        cout << "Error: more than 2^32 nodes in the graph. Exit." << endl;
+        exit(1);
+      }
+      ly.begin = nodes.size();
+      nodes.insert(nodes.end(), ly.pending.begin(), ly.pending.end());
+      ly.end = nodes.size();
+      ly.frozen = true;
+      for (uint32_t i = 0; i < slots.size(); i++) table[slots[i]].i = ly.begin + i;
+
+      vector<bool_function_t<N> >().swap(ly.pending);
+    }
+
+    // a file of the former format: the operands are given by their depth and bit slice
+    int read_former_layer(int c, string fn, bool expanded)
+    {
+      ifstream fin(fn, ios::binary);
+      bool_function_t<N> f_t;
+      vector<bool_function_t<N> > recs;
+
+      auto operand = [&](int k)
+      {
+        int depth;
+        bit_slice_l_t<N> opv_tmp;
+        fin.read((char *)&(depth), sizeof(int));
+        fin.read((char *)&(opv_tmp), sizeof(bit_slice_l_t<N>));
+        long i = index(opv_tmp);
+        if (!fin || (i < 0) || (depth >= c))
+        {
+          cout << "Error: " << fn << " refers to an unknown operand" << endl;
+          return false;
+        }
+        f_t.operands[k] = i;
+        return true;
+      };
+
+      while (fin.read((char *)&(f_t.bit_slice), sizeof(bit_slice_l_t<N>)))
+      {
+        fin.read((char *)&(f_t.info_op), sizeof(uint8_t));
+        f_t.operands[0] = 0;
+        f_t.operands[1] = 0;
+        f_t.operands[2] = 0;
+        bool ok = true;
+        switch(f_t.info_op)
+        {
+          case NOP   : break;
+          case NAND3 :
+          case NOR3  :
+          case OR3   :
+          case AND3  : ok = ok && operand(2);
+          case AND2  :
+          case NAND2 :
+          case OR2   :
+          case NOR2  :
+          case XOR2  :
+          case XNOR2 :
+          case MOAI1 :
+          case MAOI1 :
+          case ANDN2 :
+          case ORN2  : ok = ok && operand(1);
+          case NOT1  : ok = ok && operand(0); break;
+          default    : ok = false; cout << "Error: " << fn << " has an unknown operation" << endl;
+        }
+        fin.read((char *)&(f_t.area), sizeof(int));
+        if (!ok || !fin) return -1;
+        recs.push_back(f_t);
+      }
+
+      insert(c, recs.begin(), recs.end());
+      if (expanded) freeze(layers[c]);
+      return 1;
+    }
+};
+
+/*
+  The successors generated by one thread for one gate, at most one per bit
+  slice: a successor replaces the one kept for its bit slice only if it is
+  smaller for the order less, so the duplicates are never stored.
+  The successors of a function which is in a frozen layer of the graph are
+  dropped as well, they could not be inserted in it.
+  An open-addressing table (linear probing) over the bit slices gives the
+  position of the successor of a bit slice.
+*/
+template<int N>
+class Peigen::depth::successor_list_t
+{
+public:
+    vector<bool_function_t<N> > list;
+    uint64_t generated = 0; // number of successors pushed, the dropped ones included
+
+    successor_list_t(const graphe_t<N> * graphe) : graphe(graphe)
+    {
+      table.assign(DEPTH_GRAPHE_TABLE_INIT_N, 0);
+      mask = DEPTH_GRAPHE_TABLE_INIT_N - 1;
+    }
+
+    template<class Less>
+    void push_back(const bool_function_t<N> & f, Less less)
+    {
+      generated++;
+      if (graphe->index(f.bit_slice) >= 0) return;
+      size_t pos = graphe_t<N>::hash(f.bit_slice) & mask;
+      while (table[pos] != 0)
+      {
+        bool_function_t<N> & g = list[table[pos] - 1];
+        if (g.bit_slice == f.bit_slice)
+        {
+          if (less(f, g)) g = f;
+          return;
+        }
+        pos = (pos + 1) & mask;
+      }
+      list.push_back(f);
+      table[pos] = list.size();
+      // keep the load factor below 1/2
+      if (2 * list.size() > table.size()) rehash(2 * table.size());
+    }
+
+private:
+    const graphe_t<N> * graphe;
+    vector<uint32_t> table; // 1 + the position of the successor in list, 0 for an empty slot
+    size_t mask;
+
+    void rehash(size_t table_size)
+    {
+      table.assign(table_size, 0);
+      mask = table_size - 1;
+      for (uint32_t i = 0; i < list.size(); i++)
+      {
+        size_t pos = graphe_t<N>::hash(list[i].bit_slice) & mask;
+        while (table[pos] != 0) pos = (pos + 1) & mask;
+        table[pos] = i + 1;
+      }
+    }
+};
+
+#endif // FASTER_GRAPHE_H__
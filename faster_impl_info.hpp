@@ -50,7 +50,7 @@ string faster<N>::get_implementation(bool_function_t<N> f1)
   switch(op)
   {
     case NOT1  : 
-                s = bool_op_str(op) + "( "+ get_implementation(*f1.operands[0]) + " ) ";
+                s = bool_op_str(op) + "( "+ get_implementation(f1_succ.node(f1.operands[0])) + " ) ";
                 area_sum.insert(f1.operands[0]);
                 break;
     case AND2  :
@@ -64,8 +64,8 @@ string faster<N>::get_implementation(bool_function_t<N> f1)
     case MOAI1 :
     case MAOI1 : 
                 s = bool_op_str(op) + "( "+ 
-                      get_implementation(*f1.operands[0]) + ", " + 
-                      get_implementation(*f1.operands[1]) + " ) "; 
+                      get_implementation(f1_succ.node(f1.operands[0])) + ", " + 
+                      get_implementation(f1_succ.node(f1.operands[1])) + " ) "; 
                 area_sum.insert(f1.operands[0]);
                 area_sum.insert(f1.operands[1]);
                 break; 
@@ -74,9 +74,9 @@ string faster<N>::get_implementation(bool_function_t<N> f1)
     case OR3   :
     case AND3  :
                 s = bool_op_str(op) + "( "+ 
-                      get_implementation(*f1.operands[0]) + ", " + 
-                      get_implementation(*f1.operands[1]) + ", " + 
-                      get_implementation(*f1.operands[2]) + " ) ";
+                      get_implementation(f1_succ.node(f1.operands[0])) + ", " + 
+                      get_implementation(f1_succ.node(f1.operands[1])) + ", " + 
+                      get_implementation(f1_succ.node(f1.operands[2])) + " ) ";
                 area_sum.insert(f1.operands[0]);
                 area_sum.insert(f1.operands[1]);
                 break; 
@@ -130,7 +130,7 @@ void faster<N>::get_implementation()
     
     for (auto it : area_sum)
     {
-      area_cost += bool_op_cost((*it).info_op);
+      area_cost += bool_op_cost(f1_succ.node(it).info_op);
     }
     smallest_area = area_cost;
 
@@ -47,9 +47,6 @@ using namespace Peigen::depth;
 #ifdef PRINT
 #undef PRINT
 #endif
-#ifdef MAX_VEC_NODES
-#undef MAX_VEC_NODES
-#endif
 #ifdef pre_parse_args
 #undef pre_parse_args
 #endif
@@ -63,8 +60,6 @@ using namespace Peigen::depth;
   #define PRINT(fmt, ...) printf(fmt, (unsigned long)(__LINE__), ##__VA_ARGS__)
 #endif
 
-#define MAX_VEC_NODES (max_nodes>>1UL)
-
 #define pre_parse_args()                                      \
   int myargc = 0;                                             \
   char* myargv[50];                                           \
@@ -128,8 +123,7 @@ void faster<N>::pre_computing()
   f1.sort();
 
   f1_succ.clear();
-  f1_succ.insert(pair<int, set<bool_function_t<N> > >(0, {f1.coordinates[0]}));
-  for (int i = 1; i < N; i++ ) f1_succ[0].insert(f1.coordinates[i]);
+  for (int i = 0; i < N; i++ ) f1_succ.insert(0, f1.coordinates[i]);
 
   count_list = 0;
   while (count_list <= pre_l)
@@ -139,190 +133,36 @@ void faster<N>::pre_computing()
     count_list++;
     write_pre_bin();
   }
+  if(verbose) print_graphe_info();
 }
 
 template<int N>
 void faster<N>::write_pre_bin()
 {
-  auto find = [](const set<bool_function_t<N> > & func_set, const bit_slice_l_t<N> & bit_slice)
-  {
-    for(auto set_it = func_set.begin(); set_it != func_set.end(); set_it++)
-    {
-      if (set_it->bit_slice == bit_slice)
-      {
-        return set_it;
-      }
-    }
-    return func_set.end();
-  };
-
-  ofstream fout;
-  size_t bool_function_s = sizeof(bool_function_t<N>);
-  for (auto map_it = f1_succ.begin(); map_it != f1_succ.end(); map_it++)
+  for (auto map_it = f1_succ.layers.begin(); map_it != f1_succ.layers.end(); map_it++)
   {
     string pre_filen = "pre_" + imp_info + "_" + to_string(map_it->first) + ".bin";
-    fout.open(pre_filen, ios::binary);
-    for (auto set_it = map_it->second.begin(); set_it != map_it->second.end(); set_it++)
+    if (!f1_succ.write_layer(map_it->first, pre_filen))
     {
-      fout.write((char *)&(set_it->bit_slice), sizeof(bit_slice_l_t<N>));
-      fout.write((char *)&(set_it->info_op), sizeof(uint8_t));
-
-      bit_slice_l_t<N> opv_tmp;
-      auto map2_it = f1_succ.begin();
-
-      switch(set_it->info_op)
-      {
-        case NOP   : break;
-        case NAND3 : 
-        case NOR3  : 
-        case OR3   : 
-        case AND3  :
-                    opv_tmp = set_it->operands[2]->bit_slice;
-                    map2_it = f1_succ.begin();
-                    while (map2_it->first < map_it->first)
-                    {
-                      auto func_t = find(map2_it->second, opv_tmp);
-                      if (func_t != map2_it->second.end())
-                      {
-                        fout.write((char *)&(map2_it->first), sizeof(int));
-                        fout.write((char *)&(opv_tmp), sizeof(bit_slice_l_t<N>));
-                        break;
-                      }
-                      map2_it++;
-                    }
-                    assert(map2_it->first < map_it->first);
-        case AND2  : 
-        case NAND2 : 
-        case OR2   : 
-        case NOR2  : 
-        case XOR2  : 
-        case XNOR2 : 
-        case MOAI1 : 
-        case MAOI1 :
-        case ANDN2 : 
-        case ORN2  : 
-                    opv_tmp = set_it->operands[1]->bit_slice;
-                    map2_it = f1_succ.begin();
-                    while (map2_it->first < map_it->first)
-                    {
-                      auto func_t = find(map2_it->second, opv_tmp);
-                      if (func_t != map2_it->second.end())
-                      {
-                        fout.write((char *)&(map2_it->first), sizeof(int));
-                        fout.write((char *)&(opv_tmp), sizeof(bit_slice_l_t<N>));
-                        break;
-                      }
-                      map2_it++;
-                    }
-                    assert(map2_it->first < map_it->first);
-        case NOT1  :
-                    opv_tmp = set_it->operands[0]->bit_slice;
-                    map2_it = f1_succ.begin();
-                    while (map2_it->first < map_it->first)
-                    {
-                      auto func_t = find(map2_it->second, opv_tmp);
-                      if (func_t != map2_it->second.end())
-                      {
-                        fout.write((char *)&(map2_it->first), sizeof(int));
-                        fout.write((char *)&(opv_tmp), sizeof(bit_slice_l_t<N>));
-                        break;
-                      }
-                      map2_it++;
-                    }
-                    assert(map2_it->first < map_it->first);
-                    break;
-        default    : cout << "Write file error. Exit." << endl; exit(1); 
-      }
-      fout.write((char *)&(set_it->area), sizeof(int));
+      cout << "Write file error. Exit." << endl;
+      exit(1);
     }
-    fout.close();
   }
 }
 
 template<int N>
 void faster<N>::read_pre_bin()
 {
-  auto find = [](const set<bool_function_t<N> > & func_set, const bit_slice_l_t<N> & bit_slice)
-  {
-    for(auto set_it = func_set.begin(); set_it != func_set.end(); set_it++)
-    {
-      if (set_it->bit_slice == bit_slice)
-      {
-        return set_it;
-      }
-    }
-    return func_set.end();
-  };
-
-  ifstream fin;
-  bool_function_t<N> f_t;
   int lambda = 0;
-  size_t bool_function_s = sizeof(bool_function_t<N>);
   f1_succ.clear();
   while (lambda <= (pre_l + max_GE))
   {
     string pre_filen = "pre_" + imp_info + "_" + to_string(lambda) + ".bin";
-    fin.open(pre_filen, ios::binary);
-    if (fin)
+    if (f1_succ.read_layer(lambda, pre_filen, lambda <= pre_l) < 0)
     {
-      set<bool_function_t<N> > new_list;    
-      f1_succ.insert(pair<int, set<bool_function_t<N> > >(lambda, new_list));
-      auto to_insert = &(f1_succ[lambda]);
-
-      int depth;
-      bit_slice_l_t<N> opv_tmp;
-
-      while (fin.read((char*)&(f_t.bit_slice), sizeof(bit_slice_l_t<N>)))
-      {        
-        assert(fin);
-        fin.read((char *)&(f_t.info_op), sizeof(uint8_t));
-        assert(fin);
-        f_t.operands[0] = NULL;
-        f_t.operands[1] = NULL;
-        f_t.operands[2] = NULL;
-        switch(f_t.info_op)
-        {
-          case NOP   :
-                      break;
-          case NAND3 : 
-          case NOR3  : 
-          case OR3   : 
-          case AND3  :assert(fin);
-                      fin.read((char *)&(depth), sizeof(int));
-                      assert(fin);
-                      fin.read((char *)&(opv_tmp), sizeof(bit_slice_l_t<N>));
-                      f_t.operands[2] = &(*(find(f1_succ[depth],opv_tmp)));
-          case AND2  : 
-          case NAND2 : 
-          case OR2   : 
-          case NOR2  : 
-          case XOR2  : 
-          case XNOR2 : 
-          case MOAI1 : 
-          case MAOI1 :
-          case ANDN2 : 
-          case ORN2  :assert(fin);
-                      fin.read((char *)&(depth), sizeof(int));
-                      assert(fin);
-                      fin.read((char *)&(opv_tmp), sizeof(bit_slice_l_t<N>));
-                      f_t.operands[1] = &(*(find(f1_succ[depth],opv_tmp)));
-          case NOT1  :assert(fin);
-                      fin.read((char *)&(depth), sizeof(int));
-                      assert(fin);
-                      fin.read((char *)&(opv_tmp), sizeof(bit_slice_l_t<N>));
-                      f_t.operands[0] = &(*(find(f1_succ[depth],opv_tmp)));
-                      break;
-          default    :
-                      cout << "Read binary file error. Exit. ";
-                      fin.close();
-                      exit(1);
-        }
-        assert(fin);
-        fin.read((char *)&(f_t.area), sizeof(int));
-        to_insert->insert(f_t);
-      }
+      cout << "Read binary file error. Exit. " << endl;
+      exit(1);
     }
-    fin.close();
     lambda++;
   }
 }
@@ -474,20 +314,19 @@ void faster<N>::mitm(function_t<N> f1)
 
   if (pre_l < 0)
   {
-    f1_succ.insert(pair<int, set<bool_function_t<N> > >(0, {f1.coordinates[0]}));
-    for (int i = 1; i < N; i++) f1_succ[0].insert(f1.coordinates[i]);
+    for (int i = 0; i < N; i++) f1_succ.insert(0, f1.coordinates[i]);
   }
   else
   {
-    auto map_it = f1_succ.begin();
-    while (map_it != f1_succ.end())
+    auto map_it = f1_succ.layers.begin();
+    while (map_it != f1_succ.layers.end())
     {
       count_list = map_it->first;
       if (count_list <= shortest_path)
       {
-        for (auto it_tmp = (*map_it).second.begin(); it_tmp != (*map_it).second.end(); it_tmp++)
+        for (auto & f : f1_succ.layer(count_list))
         {
-          if(is_in_graphe_collision(count_list, 0, (*it_tmp)))
+          if(is_in_graphe_collision(count_list, 0, f))
           {
             get_implementation();
           }
@@ -536,208 +375,190 @@ void faster<N>::mitm(function_t<N> f1)
 
 
 template<int N>
-void faster<N>::expand(int lambda)
+bool faster<N>::successor_less(const bool_function_t<N> & f, const bool_function_t<N> & g)
 {
-  auto remove_dup = [](vector<bool_function_t<N> > * succ_vecs_pt, int i)
+  // a total order, so that the successor kept for a bit slice does not depend on the generation order
+  if (f.bit_slice != g.bit_slice) return f.bit_slice < g.bit_slice;
+  if (f.area != g.area) return f.area < g.area;
+  if (f.info_op != g.info_op) return f.info_op < g.info_op;
+  for (int i = 0; i < 3; i++)
   {
-    vector<bool_function_t<N> > * tmp0 = &(succ_vecs_pt[i]);
-    vector<bool_function_t<N> > * tmp1 = &(succ_vecs_pt[i^1]);
-    tmp1->clear();
-    sort(tmp0->begin(), tmp0->end());
-    auto it0 = tmp0->begin();
-    tmp1->push_back(*it0);
-    it0++;
-    while (it0 != tmp0->end())
+    if (f.operands[i] != g.operands[i]) return f.operands[i] < g.operands[i];
+  }
+  return false;
+}
+
+template<int N>
+void faster<N>::expand_node(uint32_t f1, bool_op_t bool_op, successor_list_t<N> & succ)
+{
+  /*
+    The operands are enumerated once per set for the commutative gates: f1 is
+    the node of the layer being expanded and the other operands are the
+    nodes of smaller index, in decreasing order.
+  */
+  switch (bool_op.op_id)
+  {
+    case NOT1  :
+                bool_op_one_input(f1, &succ, bool_op);
+                break;
+    case AND2  :
+    case OR2   :
+    case NAND2 :
+    case NOR2  :
+    case XOR2  :
+    case XNOR2 :
+    case MAOI1 :
+    case MOAI1 : 
+                bool_op_two_inputs(f1, 0, f1, false, &succ, bool_op);
+                break;
+    case ANDN2 :
+    case ORN2  :
+                // not commutative, both orders are needed
+                bool_op_two_inputs(f1, 0, f1, false, &succ, bool_op);
+                bool_op_two_inputs(f1, 0, f1, true, &succ, bool_op);
+                break;
+    case AND3  : 
+    case OR3   : 
+    case NAND3 : 
+    case NOR3  :
+                for (uint32_t f2 = 0; f2 < f1; f2++)
+                {
+                  bool_op_three_inputs(f1, f2, 0, f2, &succ, bool_op);
+                }
+                break;
+  }
+}
+
+template<int N>
+void faster<N>::merge_successors(vector<vector<bool_function_t<N> > > & lists, vector<bool_function_t<N> > & merged)
+{
+  int k = lists.size();
+  if (k == 1)
+  {
+    merged.swap(lists[0]);
+    return;
+  }
+
+  /*
+    The bit slices are split in k ranges at regular positions of the largest list,
+    the ranges are merged in parallel (each bit slice is in one range) and concatenated.
+  */
+  size_t largest = 0;
+  for (int t = 1; t < k; t++)
+  {
+    if (lists[t].size() > lists[largest].size()) largest = t;
+  }
+  vector<bit_slice_l_t<N> > splitters;
+  for (int r = 1; r < k; r++)
+  {
+    if (lists[largest].empty()) break;
+    splitters.push_back(lists[largest][r * lists[largest].size() / k].bit_slice);
+  }
+  int ranges = splitters.size() + 1;
+
+  // cuts[t][r] is the position of the first successor of the range r in lists[t]
+  vector<vector<size_t> > cuts(k, vector<size_t>(ranges + 1));
+  for (int t = 0; t < k; t++)
+  {
+    cuts[t][0] = 0;
+    for (int r = 1; r < ranges; r++)
     {
-      if (it0->bit_slice != tmp1->back().bit_slice)
-      {
-        tmp1->push_back(*it0);
-      }
-      it0++;
+      cuts[t][r] = lower_bound(lists[t].begin(), lists[t].end(), splitters[r - 1],
+                   [](const bool_function_t<N> & f, const bit_slice_l_t<N> & bit_slice) { return f.bit_slice < bit_slice; }) - lists[t].begin();
     }
-  };
+    cuts[t][ranges] = lists[t].size();
+  }
 
-  auto to_expand = f1_succ.find(lambda);
-  if(to_expand != f1_succ.end())
+  vector<vector<bool_function_t<N> > > parts(ranges);
+  #pragma omp parallel for schedule(dynamic, 1) num_threads(omp_nb_threads)
+  for (int r = 0; r < ranges; r++)
   {
+    // k-way merge of the range r, keeping the smallest successor of each bit slice
+    auto greater = [&](const pair<int, size_t> & a, const pair<int, size_t> & b)
+    {
+      return successor_less(lists[b.first][b.second], lists[a.first][a.second]);
+    };
+    priority_queue<pair<int, size_t>, vector<pair<int, size_t> >, decltype(greater)> heap(greater);
+    size_t n = 0;
+    for (int t = 0; t < k; t++)
+    {
+      n += cuts[t][r + 1] - cuts[t][r];
+      if (cuts[t][r] < cuts[t][r + 1]) heap.push(make_pair(t, cuts[t][r]));
+    }
+    parts[r].reserve(n);
+    while (!heap.empty())
+    {
+      auto top = heap.top();
+      heap.pop();
+      const bool_function_t<N> & f = lists[top.first][top.second];
+      if (parts[r].empty() || (parts[r].back().bit_slice != f.bit_slice)) parts[r].push_back(f);
+      if (top.second + 1 < cuts[top.first][r + 1]) heap.push(make_pair(top.first, top.second + 1));
+    }
+  }
+
+  merged.clear();
+  size_t n = 0;
+  for (auto & part : parts) n += part.size();
+  merged.reserve(n);
+  for (auto & part : parts)
+  {
+    merged.insert(merged.end(), part.begin(), part.end());
+    vector<bool_function_t<N> >().swap(part);
+  }
+}
+
+template<int N>
+void faster<N>::expand(int lambda)
+{
+  auto to_expand = f1_succ.layers.find(lambda);
+  if(to_expand != f1_succ.layers.end())
+  {
+    /*
+      The nodes of the layers below lambda are [0, first),
+      the nodes of the layer lambda are [first, last).
+    */
+    f1_succ.freeze(lambda);
+    uint32_t first = (*to_expand).second.begin;
+    uint32_t last = (*to_expand).second.end;
+    pair<uint64_t, uint64_t> & stats = succ_stats[lambda];
+    stats = make_pair(0, 0);
+
     for(auto bool_op : b)
     {
       int bool_op_cost = bool_op.op_cost;
-      vector<bool_function_t<N> > successors[2];
-      successors[0].reserve(MAX_VEC_NODES);
-      successors[1].reserve(MAX_VEC_NODES);
-      vector<bool_function_t<N> >* succ_vec_pt;
-      int i = 0;
-      succ_vec_pt = &(successors[i]);
-
-      switch (bool_op.op_id)
+
+      /*
+        The nodes of the layer are shared out between the threads, each thread
+        keeps one successor per bit slice, then the sorted successors of the
+        threads are merged. The successor kept for a bit slice is the smallest
+        one (successor_less), whatever the number of threads.
+      */
+      vector<vector<bool_function_t<N> > > thread_succ(omp_nb_threads);
+      uint64_t generated = 0;
+      #pragma omp parallel num_threads(omp_nb_threads) reduction(+:generated)
       {
-        case NOT1  :
-                    for(auto f1 = (*to_expand).second.begin(); f1 != (*to_expand).second.end(); f1++)
-                    {
-                      bool_op_one_input(&(*f1), succ_vec_pt, bool_op);
-                      if (succ_vec_pt->size() >= MAX_VEC_NODES)
-                      {
-                        PRINT("Line:: %lu: Before remove_dup successors.size(): %lu\n", succ_vec_pt->size());
-                        remove_dup(successors, i);
-                        i = i ^ 1;
-                        succ_vec_pt = &(successors[i]);
-                        PRINT("Line:: %lu: After remove_dup successors.size(): %lu\n", succ_vec_pt->size());
-                      }
-                    }
-                    break;
-        case AND2  :
-        case OR2   :
-        case NAND2 :
-        case NOR2  :
-        case XOR2  :
-        case XNOR2 :
-        case MAOI1 :
-        case MOAI1 : 
-                    for(auto f1 = (*to_expand).second.begin(); f1 != (*to_expand).second.end(); f1++)
-                    {
-                      for(auto f2map = f1_succ.begin(); f2map != to_expand; f2map++)
-                      {
-                        for (auto f2 = (*f2map).second.begin(); f2 != (*f2map).second.end(); f2++)
-                        {
-                          bool_op_two_inputs(&(*f1), &(*f2), succ_vec_pt, bool_op);
-                          if (succ_vec_pt->size() >= MAX_VEC_NODES)
-                          {
-                            PRINT("Line:: %lu: Before remove_dup successors.size(): %lu\n", succ_vec_pt->size());
-                            remove_dup(successors, i);
-                            i = i ^ 1;
-                            succ_vec_pt = &(successors[i]);
-                            PRINT("Line:: %lu: After remove_dup successors.size(): %lu\n", succ_vec_pt->size());
-                          }
-                        }
-                      }
-                      for (auto f2 = (*to_expand).second.begin(); f2 != f1; f2++)
-                      {
-                        bool_op_two_inputs(&(*f1), &(*f2), succ_vec_pt, bool_op);
-                        if (succ_vec_pt->size() >= MAX_VEC_NODES)
-                        {
-                          PRINT("Line:: %lu: Before remove_dup successors.size(): %lu\n", succ_vec_pt->size());
-                          remove_dup(successors, i);
-                          i = i ^ 1;
-                          succ_vec_pt = &(successors[i]);
-                          PRINT("Line:: %lu: After remove_dup successors.size(): %lu\n", succ_vec_pt->size());
-                        }
-                      }
-                    }
-                    break;
-        case ANDN2 :
-        case ORN2  :
-                    for(auto f1 = (*to_expand).second.begin(); f1 != (*to_expand).second.end(); f1++)
-                    {
-                      for(auto f2map = f1_succ.begin(); f2map != to_expand; f2map++)
-                      {
-                        for (auto f2 = (*f2map).second.begin(); f2 != (*f2map).second.end(); f2++)
-                        {
-                          bool_op_two_inputs(&(*f1), &(*f2), succ_vec_pt, bool_op);
-                          bool_op_two_inputs(&(*f2), &(*f1), succ_vec_pt, bool_op);
-                          if (succ_vec_pt->size() >= MAX_VEC_NODES)
-                          {
-                            PRINT("Line:: %lu: Before remove_dup successors.size(): %lu\n", succ_vec_pt->size());
-                            remove_dup(successors, i);
-                            i = i ^ 1;
-                            succ_vec_pt = &(successors[i]);
-                            PRINT("Line:: %lu: After remove_dup successors.size(): %lu\n", succ_vec_pt->size());
-                          }
-                        }                        
-                      }
-                      for (auto f2 = (*to_expand).second.begin(); f2 != f1; f2++)
-                      {
-                        bool_op_two_inputs(&(*f1), &(*f2), succ_vec_pt, bool_op);
-                        bool_op_two_inputs(&(*f2), &(*f1), succ_vec_pt, bool_op);
-                        if (succ_vec_pt->size() >= MAX_VEC_NODES)
-                        {
-                          PRINT("Line:: %lu: Before remove_dup successors.size(): %lu\n", succ_vec_pt->size());
-                          remove_dup(successors, i);
-                          i = i ^ 1;
-                          succ_vec_pt = &(successors[i]);
-                          PRINT("Line:: %lu: After remove_dup successors.size(): %lu\n", succ_vec_pt->size());
-                        }
-                      }
-                    }
-                    break;
-        case AND3  : 
-        case OR3   : 
-        case NAND3 : 
-        case NOR3  :
-                    for(auto f1 = (*to_expand).second.begin(); f1 != (*to_expand).second.end(); f1++)
-                    {
-                      for(auto f2map = f1_succ.begin(); f2map != to_expand; f2map++)
-                      {
-                        for (auto f2 = (*f2map).second.begin(); f2 != (*f2map).second.end(); f2++)
-                        {
-                          for(auto f3map = f1_succ.begin(); f3map != f2map; f3map++)
-                          {
-                            for (auto f3 = (*f3map).second.begin(); f3 != (*f3map).second.end(); f3++)
-                            {
-                              bool_op_three_inputs(&(*f1), &(*f2), &(*f3), succ_vec_pt, bool_op);
-                              if (succ_vec_pt->size() >= MAX_VEC_NODES)
-                              {
-                                PRINT("Line:: %lu: Before remove_dup successors.size(): %lu\n", succ_vec_pt->size());
-                                remove_dup(successors, i);
-                                i = i ^ 1;
-                                succ_vec_pt = &(successors[i]);
-                                PRINT("Line:: %lu: After remove_dup successors.size(): %lu\n", succ_vec_pt->size());
-                              }
-                            }
-                          }
-                          for (auto f3 = (*f2map).second.begin(); f3 != f2; f3++)
-                          {
-                            bool_op_three_inputs(&(*f1), &(*f2), &(*f3), succ_vec_pt, bool_op);
-                            if (succ_vec_pt->size() >= MAX_VEC_NODES)
-                            {
-                              PRINT("Line:: %lu: Before remove_dup successors.size(): %lu\n", succ_vec_pt->size());
-                              remove_dup(successors, i);
-                              i = i ^ 1;
-                              succ_vec_pt = &(successors[i]);
-                              PRINT("Line:: %lu: After remove_dup successors.size(): %lu\n", succ_vec_pt->size());
-                            }
-                          }
-                        }
-                      }
-                      for (auto f2 = (*to_expand).second.begin(); f2 != f1; f2++)
-                      {
-                        for (auto f3 = (*to_expand).second.begin(); f3 != f2; f3++)
-                        {
-                          bool_op_three_inputs(&(*f1), &(*f2), &(*f3), succ_vec_pt, bool_op);
-                          if (succ_vec_pt->size() >= MAX_VEC_NODES)
-                          {
-                            PRINT("Line:: %lu: Before remove_dup successors.size(): %lu\n", succ_vec_pt->size());
-                            remove_dup(successors, i);
-                            i = i ^ 1;
-                            succ_vec_pt = &(successors[i]);
-                            PRINT("Line:: %lu: After remove_dup successors.size(): %lu\n", succ_vec_pt->size());
-                          }
-                        }
-                      }
-                    }
-                    break;
+        successor_list_t<N> succ(&f1_succ);
+        #pragma omp for schedule(dynamic, 1)
+        for (uint32_t f1 = first; f1 < last; f1++)
+        {
+          expand_node(f1, bool_op, succ);
+        }
+        generated += succ.generated;
+        sort(succ.list.begin(), succ.list.end(), [](const bool_function_t<N> & f, const bool_function_t<N> & g) { return f.bit_slice < g.bit_slice; });
+        thread_succ[omp_get_thread_num()].swap(succ.list);
       }
+      stats.first += generated;
 
-      if(succ_vec_pt->size() != 0)
-      { 
-        PRINT("Line:: %lu: Before remove_dup successors.size(): %lu\n", succ_vec_pt->size());
-        remove_dup(successors, i);
-        i = i ^ 1;
-        succ_vec_pt = &(successors[i]);
-        PRINT("Line:: %lu: After remove_dup successors.size(): %lu\n", succ_vec_pt->size());
+      vector<bool_function_t<N> > successors;
+      merge_successors(thread_succ, successors);
 
-        auto s = f1_succ.find(lambda + bool_op_cost);
+      if(successors.size() != 0)
+      { 
         set<bool_function_t<N> > new_list;
-        v_list_process(lambda, bool_op_cost, succ_vec_pt, &new_list);
+        v_list_process(lambda, bool_op_cost, &successors, &new_list);
+        stats.second += new_list.size();
 
-        if(s != f1_succ.end())
-        {
-          s->second.insert(new_list.begin(), new_list.end());     
-        }
-        else
-        {
-          f1_succ.insert(pair<int,set<bool_function_t<N> > >(lambda + bool_op_cost, new_list));
-        }
+        f1_succ.insert(lambda + bool_op_cost, new_list.begin(), new_list.end());
       }
     }
   }
@@ -779,33 +600,16 @@ void faster<N>::v_list_process(int lambda, int op_cost, vector<bool_function_t<N
 template<int N>
 bool faster<N>::is_in_graphe(int lambda, int op_cost, bool_function_t<N> f)
 {
-  auto find = [](const set<bool_function_t<N> > & func_set, const bit_slice_l_t<N> & bit_slice)
-  {
-    for(auto set_it = func_set.begin(); set_it != func_set.end(); set_it++)
-    {
-      if (set_it->bit_slice == bit_slice)
-      {
-        return set_it;
-      }
-    }
-    return func_set.end();
-  };
-
-  for(auto it = f1_succ.begin(); it != f1_succ.end() ; it++)
+  // the graph is only read here, the dominated node is replaced by the insertion of f
+  const typename graphe_t<N>::layer_t * layer;
+  auto found_f = f1_succ.find(f.bit_slice, &layer);
+  if (found_f != NULL)
   {
-    auto found_f = find((*it).second, f.bit_slice);
-    if(found_f != (*it).second.end())
+    if(!layer->frozen && ((layer->depth > lambda+op_cost) || ((layer->depth == lambda+op_cost) && (found_f->area > f.area))))
     {
-      if(((*it).first > lambda+op_cost) || (((*it).first == lambda+op_cost) && ((*found_f).area > f.area)))
-      {
-        #pragma omp critical (UpdateGraphe)
-        {
-          (*it).second.erase(found_f);
-        }
-        return false;
-      }
-      return true;
+      return false;
     }
+    return true;
   }
   return false;
 }
@@ -838,9 +642,6 @@ bool faster<N>::is_in_graphe_collision(int lambda, int op_cost, bool_function_t<
 #ifdef PRINT
 #undef PRINT
 #endif
-#ifdef MAX_VEC_NODES
-#undef MAX_VEC_NODES
-#endif
 #ifdef pre_parse_args
 #undef pre_parse_args
 #endif
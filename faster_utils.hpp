@@ -48,15 +48,24 @@ void faster<N>::print_graphe_info()
 
   cout << "\n\033[0;31mf1_succ : \033[0m";
 
-  auto it = f1_succ.begin();
+  auto it = f1_succ.layers.begin();
 
-  while (it != f1_succ.end())
+  while (it != f1_succ.layers.end())
   {
-    cout << (*it).first << " (" << (*it).second.size() << ") ";
-    tot_f1 += ((*it).second.size());
+    cout << (*it).first << " (" << (*it).second.size << ") ";
+    tot_f1 += ((*it).second.size);
     it++;
   }
   cout << "\n\033[1;33mTotal = " << tot_f1;
+
+  cout << "\n\033[0;31mgenerated/kept : \033[0m";
+  for (auto & stats : succ_stats)
+  {
+    cout << stats.first << " (" << stats.second.first << "/" << stats.second.second;
+    if (stats.second.second != 0) cout << " = " << (double)stats.second.first / stats.second.second;
+    cout << ") ";
+  }
+  cout << endl;
 }
 
 template<int N>
@@ -71,7 +80,7 @@ void faster<N>::exit_m()
 }
 
 template<int N>
-void faster<N>::graphe_to_file(map<int, set<bool_function_t<N> > > *graphe,
+void faster<N>::graphe_to_file(graphe_t<N> *graphe,
                     string graphe_name)
 {
   string name;
@@ -81,21 +90,21 @@ void faster<N>::graphe_to_file(map<int, set<bool_function_t<N> > > *graphe,
   */
   ofstream file_info(graphe_name + "_infos.txt");
   file_info << "Number of lists in graph : "
-            << graphe->size()
+            << graphe->layers.size()
             << endl;
-  auto it_graphe = graphe->begin();
-  while(it_graphe != graphe->end())
+  auto it_graphe = graphe->layers.begin();
+  while(it_graphe != graphe->layers.end())
   {
-    if((*it_graphe).second.size() != 0)
+    if((*it_graphe).second.size != 0)
     {
-      tot_number += (*it_graphe).second.size();
+      tot_number += (*it_graphe).second.size;
       file_info << "Number of nodes in list "
               << (*it_graphe).first
               << " : "
-              <<  (*it_graphe).second.size()
+              <<  (*it_graphe).second.size
               << endl;
     }
-    if((*it_graphe).second.size() != 0)
+    if((*it_graphe).second.size != 0)
     {
       name = graphe_name
             + string("_list_")
@@ -108,11 +117,9 @@ void faster<N>::graphe_to_file(map<int, set<bool_function_t<N> > > *graphe,
       */
       if(file_list.is_open())
       {
-        auto it_curr = (*it_graphe).second.begin();
-        while(it_curr != (*it_graphe).second.end())
+        for (auto & f : graphe->layer_copy((*it_graphe).first))
         {
-          file_list << (*it_curr).to_string()<<endl;
-          it_curr++;
+          file_list << f.to_string()<<endl;
         }
       }
       file_list.close();
@@ -964,6 +964,49 @@ struct Peigen::function_t
     }
   }
 
+  // !!! Only applicable for N = 3, 4, 5, 6, 7, 8
+  // D[x] = S[x] ^ S[x ^ id] for all x.
+  // For N >= 5, two 16-entry blocks of the LUT are handled per __m256i:
+  // the low nibble of id permutes the entries inside a block (_mm256_shuffle_epi8),
+  // the high bits of id permute the blocks themselves.
+  void difference_row(uint8_t D[LUT_XMM_N * 16], const int id) const
+  {
+    if (N >= 5)
+    {
+      const __m256i idl = _mm256_broadcastsi128_si256(_mm_xor_si128(x, _mm_set1_epi8(id & 0xf)));
+      const int idh = id >> 4;
+      for (int j = 0; j < LUT_XMM_N; j += 2)
+      {
+        __m256i t1 = _mm256_loadu_si256((const __m256i *)(LUT + j));
+        __m256i t2 = _mm256_loadu_si256((const __m256i *)(LUT + (j ^ (idh & ~1))));
+        if (idh & 1) t2 = _mm256_permute2x128_si256(t2, t2, 0x01);
+        t2 = _mm256_shuffle_epi8(t2, idl);
+        _mm256_store_si256((__m256i *)(D + j * 16), _mm256_xor_si256(t1, t2));
+      }
+    }
+    else
+    {
+      const uint8_t * S = (const uint8_t *)LUT;
+      for (int x = 0; x < LUT_UNIT_N; x++)
+      {
+        D[x] = S[x] ^ S[x ^ id];
+      }
+    }
+  }
+
+  // Add the row id of the DDT to DDT_id, D is the buffer of difference_row().
+  // x and x ^ id give the same output difference,
+  // so only the x with the highest bit of id unset are counted, twice.
+  void difference_row_count(uint8_t D[LUT_XMM_N * 16], const int id, int DDT_id[LUT_UNIT_N]) const
+  {
+    difference_row(D, id);
+    int hb = 1 << (31 - __builtin_clz(id));
+    for (int k = 0; k < (LUT_UNIT_N >> 1); k++)
+    {
+      DDT_id[D[((k & ~(hb - 1)) << 1) | (k & (hb - 1))]] += 2;
+    }
+  }
+
   void difference_distribution_matrix(int DDT[LUT_UNIT_N][LUT_UNIT_N], int & Diff, int DDT_spectrum[LUT_UNIT_N+1], int & Diff1, int DDT1_spectrum[LUT_UNIT_N+1]) const
   {
     memset(DDT[0], 0, sizeof(int) * LUT_UNIT_N * LUT_UNIT_N);
@@ -1071,47 +1114,26 @@ struct Peigen::function_t
     else if (N <= 8)
     {
       int cnt;
+      ALIGNED_TYPE_(uint8_t, 32) D[LUT_XMM_N * 16];
 
-      uint8_t * S = (uint8_t *)LUT;
-      for (int i = 1; i <= N; i++)
+      for (int i = 1; i < LUT_UNIT_N; i++)
       {
         int id = HWorder<N>[i];
-
-        for (int x = 0; x < LUT_UNIT_N; x++)
-        {
-          int od = S[x] ^ S[x ^ id];
-          DDT[id][od]++;
-        }
-        for (int o = 1; o <= N; o++)
-        {
-          int od = HWorder<N>[o];
-          cnt = DDT[id][od];
-          Diff = cnt > Diff ? cnt : Diff;
-          DDT_spectrum[cnt]++;
-          Diff1 = cnt > Diff1 ? cnt : Diff1;
-          DDT1_spectrum[cnt]++;
-        }
-        for (int o = N + 1; o <= LUT_UNIT_N; o++)
+        difference_row_count(D, id, DDT[id]);
+        for (int od = 0; od < LUT_UNIT_N; od++)
         {
-          int od = HWorder<N>[o%LUT_UNIT_N];
           cnt = DDT[id][od];
           DDT_spectrum[cnt]++;
           Diff = cnt > Diff ? cnt : Diff;
         }
-      }
-      for (int i = N + 1; i < LUT_UNIT_N; i++)
-      {
-        int id = HWorder<N>[i];
-        for (int x = 0; x < LUT_UNIT_N; x++)
-        {
-          int od = S[x] ^ S[x ^ id];
-          DDT[id][od]++;
-        }
-        for (int od = 0; od < LUT_UNIT_N; od++)
+        if (i <= N)
         {
-          cnt = DDT[id][od];
-          DDT_spectrum[cnt]++;
-          Diff = cnt > Diff ? cnt : Diff;
+          for (int o = 1; o <= N; o++)
+          {
+            cnt = DDT[id][HWorder<N>[o]];
+            Diff1 = cnt > Diff1 ? cnt : Diff1;
+            DDT1_spectrum[cnt]++;
+          }
         }
       }
       DDT[0][0] = LUT_UNIT_N;
@@ -1277,60 +1299,60 @@ struct Peigen::function_t
     }
     else if (N <= 8)
     {
+      ALIGNED_TYPE_(uint8_t, 32) D[LUT_XMM_N * 16];
       int DDT_id[LUT_UNIT_N];
       int cnt;
 
-      uint8_t * S = (uint8_t *)LUT;
-      for (int i = 1; i <= N; i++)
+      // The rows are visited in HWorder and computed whole as in
+      // difference_distribution_matrix(), the test stops after the first row
+      // with an entry above its bound: a row costs no more than in the full
+      // DDT, and a bound stops a random S-box within the first rows anyway.
+      // The entries of weight-1 input and output differences are checked
+      // against MaxDiff1_Bound, the others against MaxDiff_Bound (only if computeAll).
+      // Diff can not exceed Diff_max, thus DiffFreq is exceeded once the
+      // frequency of an entry equal to Diff_max is
+      int Diff_max = MaxDiff_Bound > MaxDiff1_Bound ? MaxDiff_Bound : MaxDiff1_Bound;
+
+      for (int i = 1; i < (computeAll ? LUT_UNIT_N : N + 1); i++)
       {
         int id = HWorder<N>[i];
         memset(DDT_id, 0, sizeof(int) * LUT_UNIT_N);
-        for (int x = 0; x < LUT_UNIT_N; x++)
+        difference_row_count(D, id, DDT_id);
+        if (i <= N)
         {
-          int od = S[x] ^ S[x ^ id];
-          DDT_id[od]++;
-        }
-        for (int o = 1; o <= N; o++)
-        {
-          int od = HWorder<N>[o];
-          cnt = DDT_id[od];
-          if (cnt > MaxDiff1_Bound) return false;
-          CardD1 += (cnt == 0) ? 0 : 1;
-          if (CardD1 > CardD1_Bound) return false;
-          Diff = cnt > Diff ? cnt : Diff;
-          DDT_spectrum[cnt]++;
+          for (int o = 1; o <= N; o++)
+          {
+            cnt = DDT_id[HWorder<N>[o]];
+            if (cnt > MaxDiff1_Bound) return false;
+            CardD1 += (cnt == 0) ? 0 : 1;
+            if (CardD1 > CardD1_Bound) return false;
+          }
         }
         if (computeAll)
         {
-          for (int o = N + 1; o <= LUT_UNIT_N; o++)
+          // the bounds are checked once per row, as the spectrum only grows
+          int row_max = 0;
+          for (int od = 0; od < LUT_UNIT_N; od++)
           {
-            int od = HWorder<N>[o%LUT_UNIT_N];
             cnt = DDT_id[od];
-            if (cnt > MaxDiff_Bound) return false;
-            Diff = cnt > Diff ? cnt : Diff;
+            row_max = cnt > row_max ? cnt : row_max;
             DDT_spectrum[cnt]++;
           }
+          if (row_max > MaxDiff_Bound)
+          {
+            // only the entries checked against MaxDiff1_Bound above may exceed it
+            if (i > N) return false;
+            for (int od = 0; od < LUT_UNIT_N; od++)
+            {
+              if ((DDT_id[od] > MaxDiff_Bound) && ((od == 0) || ((od & (od - 1)) != 0))) return false;
+            }
+          }
+          Diff = row_max > Diff ? row_max : Diff;
+          if ((Diff_max <= LUT_UNIT_N) && (DDT_spectrum[Diff_max] > DiffFreq_Bound)) return false;
         }
       }
       if (computeAll)
       {
-        for (int i = N + 1; i < LUT_UNIT_N; i++)
-        {
-          int id = HWorder<N>[i];
-          memset(DDT_id, 0, sizeof(int) * LUT_UNIT_N);
-          for (int x = 0; x < LUT_UNIT_N; x++)
-          {
-            int od = S[x] ^ S[x ^ id];
-            DDT_id[od]++;
-          }
-          for (int od = 0; od < LUT_UNIT_N; od++)
-          {
-            cnt = DDT_id[od];
-            if (cnt > MaxDiff_Bound) return false;
-            Diff = cnt > Diff ? cnt : Diff;
-            DDT_spectrum[cnt]++;
-          }
-        }
         if (DDT_spectrum[Diff] > DiffFreq_Bound) return false;
       }
       return true;
@@ -1483,6 +1505,81 @@ struct Peigen::function_t
     }   
   }
 
+  // !!! Only applicable for N = 3, 4, 5, 6, 7, 8
+  // Signed Walsh spectrum W[a][b] = sum_x (-1)^(a.x + b.S(x)), W[a][b] for b >= 2^N is padding.
+  // The fast Walsh-Hadamard transform runs over x for all the 2^N components at once:
+  // row x starts as the row S(x) of the Hadamard matrix and every butterfly
+  // combines two whole rows, 16 components per __m256i.
+  void walsh_spectrum(int16_t W[LUT_UNIT_N][WALSH_YMM_N * 16]) const
+  {
+    const uint8_t * S = (const uint8_t *)LUT;
+
+    for (int x = 0; x < LUT_UNIT_N; x++)
+    {
+      const __m256i row = _mm256_load_si256((const __m256i *)H4_epi16[S[x] & 0xf]);
+      const __m256i nrow = _mm256_sub_epi16(zero_256, row);
+      __m256i * Wx = (__m256i *)W[x];
+      for (int j = 0; j < WALSH_YMM_N; j++)
+      {
+        Wx[j] = (_mm_popcnt_u32((S[x] >> 4) & j) & 1) ? nrow : row;
+      }
+    }
+
+    for (int h = 1; h < LUT_UNIT_N; h <<= 1)
+    {
+      for (int i = 0; i < LUT_UNIT_N; i += (h << 1))
+      {
+        for (int x = i; x < i + h; x++)
+        {
+          __m256i * W0 = (__m256i *)W[x];
+          __m256i * W1 = (__m256i *)W[x + h];
+          for (int j = 0; j < WALSH_YMM_N; j++)
+          {
+            __m256i t0 = W0[j];
+            __m256i t1 = W1[j];
+            W0[j] = _mm256_add_epi16(t0, t1);
+            W1[j] = _mm256_sub_epi16(t0, t1);
+          }
+        }
+      }
+    }
+  }
+
+  // !!! Only applicable for N = 3, 4, 5, 6, 7, 8
+  // LAT read off a Walsh spectrum W already computed by walsh_spectrum()
+  void linear_approximation_matrix(int LAT[LUT_UNIT_N][LUT_UNIT_N], int & Lin, int LAT_spectrum[LUT_UNIT_N+1], int & Lin1, int LAT1_spectrum[LUT_UNIT_N+1], const int16_t W[LUT_UNIT_N][WALSH_YMM_N * 16]) const
+  {
+    memset(LAT[0], 0, sizeof(int) * LUT_UNIT_N * LUT_UNIT_N);
+    Lin = 0;
+    memset(LAT_spectrum, 0, sizeof(int) * (LUT_UNIT_N+1));
+    Lin1 = 0;
+    memset(LAT1_spectrum, 0, sizeof(int) * (LUT_UNIT_N+1));
+
+    int cnt;
+    for (int im = 0; im < LUT_UNIT_N; im++)
+    {
+      for (int om = 1; om < LUT_UNIT_N; om++)
+      {
+        cnt = abs(W[im][om]);
+        LAT[im][om] = cnt;
+        Lin = Lin >= cnt ? Lin : cnt;
+        LAT_spectrum[cnt]++;
+      }
+    }
+    for (int i = 1; i <= N; i++)
+    {
+      for (int o = 1; o <= N; o++)
+      {
+        cnt = LAT[HWorder<N>[i]][HWorder<N>[o]];
+        Lin1 = Lin1 >= cnt ? Lin1 : cnt;
+        LAT1_spectrum[cnt]++;
+      }
+    }
+    LAT[0][0] = LUT_UNIT_N;
+    LAT_spectrum[LUT_UNIT_N]++;
+    LAT_spectrum[0] += LUT_UNIT_N - 1;
+  }
+
   void linear_approximation_matrix(int LAT[LUT_UNIT_N][LUT_UNIT_N], int & Lin, int LAT_spectrum[LUT_UNIT_N+1], int & Lin1, int LAT1_spectrum[LUT_UNIT_N+1]) const
   {
     memset(LAT[0], 0, sizeof(int) * LUT_UNIT_N * LUT_UNIT_N);
@@ -1491,6 +1588,15 @@ struct Peigen::function_t
     Lin1 = 0;
     memset(LAT1_spectrum, 0, sizeof(int) * (LUT_UNIT_N+1));
 
+    #ifndef NFWHT
+    if (N <= 8)
+    {
+      ALIGNED_TYPE_(int16_t, 32) W[LUT_UNIT_N][WALSH_YMM_N * 16];
+      walsh_spectrum(W);
+      linear_approximation_matrix(LAT, Lin, LAT_spectrum, Lin1, LAT1_spectrum, W);
+    }
+    else
+    #endif
     if (N == 4)
     {
 	    __m128i t1;
@@ -1687,6 +1793,79 @@ struct Peigen::function_t
     fout << show_linear_approximation_matrix();
   }
 
+  // Truth tables for N = 3, 5, 6, 7, 8, on 2^N bits zero-padded to 256 bits:
+  // coor[i] of the coordinate i of the function, lin[i] of the input bit i.
+  void coordinates_truth_tables(__m256i coor[N], __m256i lin[N]) const
+  {
+    uint64_t valid[4];
+    for (int k = 0; k < 4; k++)
+    {
+      if (64 * k >= LUT_UNIT_N) valid[k] = 0;
+      else if (64 * (k + 1) <= LUT_UNIT_N) valid[k] = ~0ULL;
+      else valid[k] = (1ULL << (LUT_UNIT_N - 64 * k)) - 1;
+    }
+    const __m256i valid_mask = _mm256_set_epi64x(valid[3], valid[2], valid[1], valid[0]);
+
+    for (int i = 0; i < N; i++)
+    {
+      ALIGNED_TYPE_(uint16_t, 32) tt[16] = {0};
+      for (int j = 0; j < LUT_XMM_N; j++)
+      {
+        tt[j] = _mm_movemask_epi8(_mm_slli_epi16(LUT[j], 7 - i));
+      }
+      coor[i] = _mm256_and_si256(_mm256_load_si256((__m256i *)tt), valid_mask);
+      lin[i] = _mm256_and_si256(masks_256<N>[i], valid_mask);
+    }
+  }
+
+  // comp[HWorder[o]] for comp_n <= o <= o_max, the truth tables of the
+  // components; the component without its lowest bit precedes in HWorder
+  static void fill_components(__m256i comp[LUT_UNIT_N], int & comp_n, int o_max, const __m256i coor[N])
+  {
+    for (; comp_n <= o_max; comp_n++)
+    {
+      int om = HWorder<N>[comp_n];
+      comp[om] = _mm256_xor_si256(comp[om & (om - 1)], coor[__builtin_ctz(om)]);
+    }
+  }
+
+  // the truth table of the sum of the functions tt[i], bit i of m set
+  static __m256i truth_table_combination(const __m256i tt[N], int m)
+  {
+    __m256i res = _mm256_setzero_si256();
+    for (int i = 0; i < N; i++)
+    {
+      if ((m >> i) & 1) res = _mm256_xor_si256(res, tt[i]);
+    }
+    return res;
+  }
+
+  // |Walsh coefficient| of the function of truth table tt, i.e., a LAT entry
+  static int truth_table_walsh_abs(__m256i tt)
+  {
+    ALIGNED_TYPE_(uint64_t, 32) w[4];
+    _mm256_store_si256((__m256i *)w, tt);
+    int wt = 0;
+    for (int k = 0; k < (LUT_UNIT_N + 63) / 64; k++) wt += _mm_popcnt_u64(w[k]);
+    return 2 * abs(wt - (LUT_UNIT_N / 2));
+  }
+
+  // Smallest bound of the LAT entries for which a random permutation is expected
+  // to have fewer than 4 entries above it. An entry is the absolute value of a
+  // sum of 2^N signs, about normal of variance 2^N, and a multiple of 4.
+  // Below that bound the entries checked one at a time stop the test early,
+  // from that bound the whole Walsh spectrum costs less.
+  static int LAT_loose_bound()
+  {
+    static const int bound = []()
+    {
+      int b = 0;
+      while ((b < LUT_UNIT_N) && ((double)LUT_UNIT_N * (LUT_UNIT_N - 1) * erfc((b + 2) / sqrt(2.0 * LUT_UNIT_N)) >= 4.0)) b += 4;
+      return b;
+    }();
+    return bound;
+  }
+
   bool linear_approximation_matrix_test(int MaxLin_Bound, int MaxLin1_Bound, int LinFreq_Bound, int CardL1_Bound) const
   {
     bool computeAll = false;
@@ -1817,68 +1996,107 @@ struct Peigen::function_t
     else if (N <= 8)
     {
       int cnt;
-      uint8_t * S = (uint8_t *)LUT;
-      for (int i = 1; i <= N; i++)
+      // Lin can not exceed Lin_max, thus LinFreq is exceeded once the
+      // frequency of an entry equal to Lin_max is
+      int Lin_max = MaxLin_Bound > MaxLin1_Bound ? MaxLin_Bound : MaxLin1_Bound;
+
+      if (computeAll && ((MaxLin_Bound < MaxLin1_Bound ? MaxLin_Bound : MaxLin1_Bound) >= LAT_loose_bound()))
       {
-        int im = HWorder<N>[i];
-        for (int o = 1; o <= N; o++)
+        // Loose bounds, or LinFreq_Bound and CardL1_Bound only, hardly ever stop
+        // the test: the entries are read off the Walsh spectrum as in
+        // linear_approximation_matrix(), in any order
+        ALIGNED_TYPE_(int16_t, 32) W[LUT_UNIT_N][WALSH_YMM_N * 16];
+        walsh_spectrum(W);
+        for (int i = 1; i <= N; i++)
         {
-          int om = HWorder<N>[o];
-          cnt = 0;
-          for (int x = 0; x < LUT_UNIT_N; x++)
+          for (int o = 1; o <= N; o++)
           {
-            int ia = im & x;
-            int oa = om & S[x];
-            int p = _mm_popcnt_u32(ia ^ oa) & 1;
-            cnt += p;
+            cnt = abs(W[HWorder<N>[i]][HWorder<N>[o]]);
+            if (cnt > MaxLin1_Bound) return false;
+            CardL1 += (cnt == 0) ? 0 : 1;
+            if (CardL1 > CardL1_Bound) return false;
           }
-          cnt = 2 * abs(cnt - (LUT_UNIT_N / 2));
+        }
+        // the bounds are checked once per row, as the spectrum only grows
+        for (int im = 0; im < LUT_UNIT_N; im++)
+        {
+          int row_max = 0;
+          for (int om = 1; om < LUT_UNIT_N; om++)
+          {
+            cnt = abs(W[im][om]);
+            row_max = cnt > row_max ? cnt : row_max;
+            LAT_spectrum[cnt]++;
+          }
+          if (row_max > MaxLin_Bound)
+          {
+            // only the entries checked against MaxLin1_Bound above may exceed it
+            if ((im == 0) || ((im & (im - 1)) != 0)) return false;
+            for (int om = 1; om < LUT_UNIT_N; om++)
+            {
+              if ((abs(W[im][om]) > MaxLin_Bound) && ((om & (om - 1)) != 0)) return false;
+            }
+          }
+          Lin = row_max > Lin ? row_max : Lin;
+          if ((Lin_max <= LUT_UNIT_N) && (LAT_spectrum[Lin_max] > LinFreq_Bound)) return false;
+        }
+        if (LAT_spectrum[Lin] > LinFreq_Bound) return false;
+        return true;
+      }
+
+      // The entries are visited in HWorder of the input and the output masks.
+      // An entry is the weight of (om . S) ^ (im . x) over the 2^N inputs,
+      // two truth tables of at most 256 bits, instead of a loop over the inputs.
+      __m256i coor[N];
+      __m256i lin[N];
+      coordinates_truth_tables(coor, lin);
+      // the truth tables of the components, filled in HWorder when first needed
+      __m256i comp[LUT_UNIT_N];
+      int comp_n = 1;
+      comp[0] = _mm256_setzero_si256();
+      auto component = [&](int o)
+      {
+        if (o >= comp_n) fill_components(comp, comp_n, o, coor);
+        return comp[HWorder<N>[o]];
+      };
+
+      for (int i = 1; i <= N; i++)
+      {
+        __m256i li = truth_table_combination(lin, HWorder<N>[i]);
+        for (int o = 1; o <= N; o++)
+        {
+          cnt = truth_table_walsh_abs(_mm256_xor_si256(li, component(o)));
           if (cnt > MaxLin1_Bound) return false;
           CardL1 += (cnt == 0) ? 0 : 1;
           if (CardL1 > CardL1_Bound) return false;
           Lin = cnt > Lin ? cnt : Lin;
           LAT_spectrum[cnt]++;
+          if (computeAll && (cnt == Lin_max) && (LAT_spectrum[cnt] > LinFreq_Bound)) return false;
         }
       }
       if (computeAll)
       {
         for (int i = 1; i <= N; i++)
         {
-          int im = HWorder<N>[i];
+          __m256i li = truth_table_combination(lin, HWorder<N>[i]);
           for (int o = N + 1; o < LUT_UNIT_N; o++)
           {
-            int om = HWorder<N>[o];
-            cnt = 0;
-            for (int x = 0; x < LUT_UNIT_N; x++)
-            {
-              int ia = im & x;
-              int oa = om & S[x];
-              int p = _mm_popcnt_u32(ia ^ oa) & 1;
-              cnt += p;
-            }
-            cnt = 2 * abs(cnt - (LUT_UNIT_N / 2));
+            cnt = truth_table_walsh_abs(_mm256_xor_si256(li, component(o)));
             if (cnt > MaxLin_Bound) return false;
             Lin = cnt > Lin ? cnt : Lin;
             LAT_spectrum[cnt]++;
+            if ((cnt == Lin_max) && (LAT_spectrum[cnt] > LinFreq_Bound)) return false;
           }
         }
         for (int i = N + 1; i <= LUT_UNIT_N; i++)
         {
-          int im = HWorder<N>[i%LUT_UNIT_N];
-          for (int om = 1; om < LUT_UNIT_N; om++)
+          __m256i li = truth_table_combination(lin, HWorder<N>[i%LUT_UNIT_N]);
+          for (int o = 1; o < LUT_UNIT_N; o++)
           {
-            cnt = 0;
-            for (int x = 0; x < LUT_UNIT_N; x++)
-            {
-              int ia = im & x;
-              int oa = om & S[x];
-              int p = _mm_popcnt_u32(ia ^ oa) & 1;
-              cnt += p;
-            }
-            cnt = 2 * abs(cnt - (LUT_UNIT_N / 2));
+            cnt = truth_table_walsh_abs(_mm256_xor_si256(li, component(o)));
             if (cnt > MaxLin_Bound) return false;
             Lin = cnt > Lin ? cnt : Lin;
             LAT_spectrum[cnt]++;
+            if ((cnt == Lin_max) && (LAT_spectrum[cnt] > LinFreq_Bound)) return false;
           }
         }
         if (LAT_spectrum[Lin] > LinFreq_Bound) return false;
@@ -1887,58 +2105,85 @@ struct Peigen::function_t
     }
   }
 
-  void get_coordinates_ANF(bit_slice_t<N> & coordinates_ANF) const
+  // Step j of the Moebius transform on 256 packed bits, the truth tables of
+  // N <= 8 are laid out back to back so a step never crosses two of them
+  static __m256i mobius_step(__m256i v, int j)
   {
-    if (N == 3)
-    {
-      __m128i coor_ANF = _mm_loadu_si128((__m128i *)bit_slice.data());
-
-      coor_ANF = _mm_and_si128(coor_ANF, S3_valv_mask8);
+    __m256i t;
+    if (j < 6) t = _mm256_sll_epi64(v, _mm_cvtsi32_si128(1 << j));
+    else if (j == 6) t = _mm256_slli_si256(v, 8);
+    else t = _mm256_permute2x128_si256(v, v, 0x08);
+    return _mm256_xor_si256(v, _mm256_and_si256(t, masks_256<N>[j]));
+  }
 
-      // compute ANF for coordinates
-      coor_ANF = _mm_xor_si128(coor_ANF, _mm_and_si128(_mm_slli_epi16(coor_ANF, 4), S3_valv_mask4));      
-      coor_ANF = _mm_xor_si128(coor_ANF, _mm_and_si128(_mm_slli_epi16(coor_ANF, 2), S3_valv_mask2));
-      coor_ANF = _mm_xor_si128(coor_ANF, _mm_and_si128(_mm_slli_epi16(coor_ANF, 1), S3_valv_mask1));
+  // Step j of the superset closure, f[u] |= f[u | 2^j] for u without bit j
+  static __m256i closure_step(__m256i v, int j)
+  {
+    __m256i t;
+    if (j < 6) t = _mm256_srl_epi64(v, _mm_cvtsi32_si128(1 << j));
+    else if (j == 6) t = _mm256_srli_si256(v, 8);
+    else t = _mm256_permute2x128_si256(v, v, 0x81);
+    return _mm256_or_si256(v, _mm256_andnot_si256(masks_256<N>[j], t));
+  }
 
-      // ANF for coordinates
-      coordinates_ANF[0][0] = (UINT_<N>)_mm_extract_epi8(coor_ANF, 0);
-	    coordinates_ANF[1][0] = (UINT_<N>)_mm_extract_epi8(coor_ANF, 1);
-	    coordinates_ANF[2][0] = (UINT_<N>)_mm_extract_epi8(coor_ANF, 2);
+  // Apply all the N steps to the n truth tables f[0..n-1], 256 bits at a time
+  static void bitsliced_transform(bit_slice_l_t<N> f[], int n, bool closure)
+  {
+    uint8_t * p = (uint8_t *)f;
+    size_t bytes = (size_t)n * sizeof(bit_slice_l_t<N>);
+    for (size_t off = 0; off < bytes; off += 32)
+    {
+      ALIGNED_TYPE_(uint8_t, 32) tail[32] = {0};
+      size_t len = bytes - off < 32 ? bytes - off : 32;
+      uint8_t * src = p + off;
+      if (len < 32) { memcpy(tail, src, len); src = tail; }
+      __m256i v = _mm256_loadu_si256((__m256i *)src);
+      for (int j = 0; j < N; j++) v = closure ? closure_step(v, j) : mobius_step(v, j);
+      _mm256_storeu_si256((__m256i *)src, v);
+      if (len < 32) memcpy(p + off, tail, len);
     }
-    else if (N == 4)
-    {
-      __m128i coor_ANF = _mm_loadu_si128((__m128i *)bit_slice.data());
-
-      coor_ANF = _mm_and_si128(coor_ANF, S4_valv_maskg);
-
-      // compute ANF for coordinates
-      coor_ANF = _mm_xor_si128(coor_ANF, _mm_and_si128(_mm_slli_epi16(coor_ANF, 8), S4_valv_mask8));
-      coor_ANF = _mm_xor_si128(coor_ANF, _mm_and_si128(_mm_slli_epi16(coor_ANF, 4), S4_valv_mask4));      
-      coor_ANF = _mm_xor_si128(coor_ANF, _mm_and_si128(_mm_slli_epi16(coor_ANF, 2), S4_valv_mask2));
-      coor_ANF = _mm_xor_si128(coor_ANF, _mm_and_si128(_mm_slli_epi16(coor_ANF, 1), S4_valv_mask1));
+  }
 
-      // ANF for coordinates
-      coordinates_ANF[0][0] = (UINT_<N>)_mm_extract_epi16(coor_ANF, 0);
-	    coordinates_ANF[1][0] = (UINT_<N>)_mm_extract_epi16(coor_ANF, 1);
-	    coordinates_ANF[2][0] = (UINT_<N>)_mm_extract_epi16(coor_ANF, 2);
-	    coordinates_ANF[3][0] = (UINT_<N>)_mm_extract_epi16(coor_ANF, 3);
-    }
-    else if (N <= 8)
+  // Truth tables to ANFs in place, for the n Boolean functions f[0..n-1]
+  static void mobius_transform(bit_slice_l_t<N> f[], int n)
+  {
+    if (N <= 8) bitsliced_transform(f, n, false);
+    else
     {
-      coordinates_ANF = bit_slice;
-      // compute ANF for coordinates
-      for (int i = 0; i < N; i++)
-      {
-        for (int j = N - 1; j >= 0; j--)
-        {
-          coordinates_ANF[i] = coordinates_ANF[i] ^ (OPs<N>.sll(coordinates_ANF[i], (1ULL<<j)) & masks<N>[j]);
-        }
-      }
+      for (int i = 0; i < n; i++)
+        for (int j = 0; j < N; j++)
+          f[i] = f[i] ^ (OPs<N>.sll(f[i], (1ULL<<j)) & masks<N>[j]);
     }
+  }
+
+  // f[u] = OR of the f[v] with v a superset of u, in place for f[0..n-1]
+  static void superset_closure(bit_slice_l_t<N> f[], int n)
+  {
+    if (N <= 8) bitsliced_transform(f, n, true);
     else
     {
-      // cout << "get_coordinates_ANF():: not support for N < 3 and N > 8" << endl;
+      for (int i = 0; i < n; i++)
+        for (int j = 0; j < N; j++)
+          f[i] = f[i] | (OPs<N>.srl(f[i], (1ULL<<j)) & ~masks<N>[j]);
+    }
+  }
+
+  void get_coordinates_ANF(bit_slice_t<N> & coordinates_ANF) const
+  {
+    coordinates_ANF = bit_slice;
+    mobius_transform(coordinates_ANF.data(), N);
+  }
+
+  // ANFs of the products of coordinates S^w = prod_{i in w} S_i for all w,
+  // S^0 being the constant 1
+  void get_products_ANF(array<bit_slice_l_t<N>, 1<<N> & products_ANF) const
+  {
+    OPs<N>.set_one_inplace(products_ANF[0]);
+    for (int w = 1; w < (1<<N); w++)
+    {
+      products_ANF[w] = products_ANF[w & (w - 1)] & bit_slice[__builtin_ctz(w)];
     }
+    mobius_transform(products_ANF.data(), 1<<N);
   }
 
   string show_coordinates_ANF() const
@@ -2008,66 +2253,11 @@ struct Peigen::function_t
   {
     bit_slice_t<N> coordinates_ANF;
     get_coordinates_ANF(coordinates_ANF);
-    if (N == 3)
-    {
-      UINT_<N> a, b, c;
-      a = coordinates_ANF[0][0];
-      b = coordinates_ANF[1][0];
-      c = coordinates_ANF[2][0];
-
-      // ANF for components
-      *((UINT_<N> *)(components_ANF[7].data())) = c ^ b ^ a;
-      *((UINT_<N> *)(components_ANF[6].data())) = c ^ b;
-      *((UINT_<N> *)(components_ANF[5].data())) = c     ^ a;
-      *((UINT_<N> *)(components_ANF[4].data())) = c;
-      *((UINT_<N> *)(components_ANF[3].data())) = b ^ a;
-      *((UINT_<N> *)(components_ANF[2].data())) = b;
-      *((UINT_<N> *)(components_ANF[1].data())) = a;
-      *((UINT_<N> *)(components_ANF[0].data())) = 0;
-    }
-    else if (N == 4)
-    {
-      UINT_<N> a, b, c, d;
-      // ANF for coordinates
-      a = coordinates_ANF[0][0];
-	    b = coordinates_ANF[1][0];
-	    c = coordinates_ANF[2][0];
-	    d = coordinates_ANF[3][0];
-
-      // ANF for components
-      *((UINT_<N> *)(components_ANF[15].data())) = d ^ c ^ b ^ a;
-      *((UINT_<N> *)(components_ANF[14].data())) = d ^ c ^ b;
-      *((UINT_<N> *)(components_ANF[13].data())) = d ^ c     ^ a;
-      *((UINT_<N> *)(components_ANF[12].data())) = d ^ c;
-      *((UINT_<N> *)(components_ANF[11].data())) = d     ^ b ^ a;
-      *((UINT_<N> *)(components_ANF[10].data())) = d     ^ b;
-      *((UINT_<N> *)(components_ANF[ 9].data())) = d         ^ a;
-      *((UINT_<N> *)(components_ANF[ 8].data())) = d;
-      *((UINT_<N> *)(components_ANF[ 7].data())) = c ^ b ^ a;
-      *((UINT_<N> *)(components_ANF[ 6].data())) = c ^ b;
-      *((UINT_<N> *)(components_ANF[ 5].data())) = c     ^ a;
-      *((UINT_<N> *)(components_ANF[ 4].data())) = c;
-      *((UINT_<N> *)(components_ANF[ 3].data())) = b ^ a;
-      *((UINT_<N> *)(components_ANF[ 2].data())) = b;
-      *((UINT_<N> *)(components_ANF[ 1].data())) = a;
-      *((UINT_<N> *)(components_ANF[ 0].data())) = 0;
-    }
-    else if (N <= 8)
-    {
-      bit_slice_t<N> coordinates_ANF;
-      get_coordinates_ANF(coordinates_ANF);
-      for (int i = 0; i < (1<<N); i++)
-      {
-        components_ANF[i].fill(0);
-        for (int j = 0; j < N; j++)
-        {
-          if ( ((i>>j) & 1) ) components_ANF[i] = components_ANF[i] ^ coordinates_ANF[j];
-        }
-      }
-    }
-    else
+    // the ANF is linear, the component b.S is the XOR of the coordinates in b
+    components_ANF[0].fill(0);
+    for (int i = 1; i < (1<<N); i++)
     {
-      // cout << "get_coordinates_ANF():: not support for N < 3 and N > 8" << endl;
+      components_ANF[i] = components_ANF[i & (i - 1)] ^ coordinates_ANF[__builtin_ctz(i)];
     }
   }
 
@@ -2265,23 +2455,9 @@ struct Peigen::function_t
       array<bit_slice_l_t<N>, 1<<N> components_ANF = {{0}};
       get_components_ANF(components_ANF);
 
-      int deg_ind[N + 1] = { 0 };
       for (int i = 1; i < (1 << N); i++)
       {
-        memset(deg_ind, 0, sizeof(int)*(N + 1));
-        for (int j = 0; j < (1 << N); j++)
-        {
-          deg_ind[_mm_popcnt_u32(j)] |= OPs<N>.get_bit(components_ANF[i], j);
-        }
-        int deg_cur = 0;
-        for (int k = N; k >= 0; k--)
-        {
-          if (deg_ind[k] == 1)
-          {
-            deg_cur = k;
-            break;
-          } 
-        }
+        int deg_cur = degree_from_ANF(components_ANF[i]);
         max_degree = deg_cur > max_degree ? deg_cur : max_degree;
         min_degree = deg_cur < min_degree ? deg_cur : min_degree;
       }
@@ -2299,130 +2475,30 @@ struct Peigen::function_t
 
   bool coordinates_degree_test(const int max_degree_bound, const int min_degree_bound) const
   {
-    int max_degree = 0;
-    int min_degree = numeric_limits<int>::max();
+    bit_slice_t<N> coordinates_ANF;
+    get_coordinates_ANF(coordinates_ANF);
 
-    if (N == 3)
+    for (int i = 0; i < N; i++)
     {
-      uint8_t a, b, c;
-
-      __m128i deg3_ind;
-      __m128i deg2_ind;
-      __m128i deg1_ind;
-
-      int deg3_cnt = 0; 
-      int deg2_cnt = 0; 
-      int deg1_cnt = 0; 
-      int deg0_cnt = 0; 
-
-      // Compute ANF for coordinates
-      array<bit_slice_l_t<N>, N> ALIGNED_(16) coordinates_ANF = {{0}};
-      get_coordinates_ANF(coordinates_ANF);
-      __m128i coordinates_ANF_all = _mm_load_si128((__m128i *)((*coordinates_ANF.data()).data()));
-      coordinates_ANF_all = _mm_xor_si128(coordinates_ANF_all, S3_valv_mask8);
-
-      deg3_ind = _mm_cmpeq_epi8(_mm_and_si128(coordinates_ANF_all, S3_coors_deg_mask3), zero_128); // is not deg3 0xffff, is deg3 0x0000
-      deg3_cnt = _mm_popcnt_u32(_mm_movemask_epi8(_mm_xor_si128(_mm_and_si128(deg3_ind, S3_coors_ind_mask), S3_coors_ind_mask)));     
-
-      coordinates_ANF_all = _mm_and_si128(coordinates_ANF_all, deg3_ind); // if is not deg3
-      deg2_ind = _mm_cmpeq_epi8(_mm_and_si128(coordinates_ANF_all, S3_coors_deg_mask2), zero_128); // is not deg2 0xffff, is deg2 0x0000
-      deg2_cnt = _mm_popcnt_u32(_mm_movemask_epi8(_mm_xor_si128(_mm_and_si128(deg2_ind, S3_coors_ind_mask), S3_coors_ind_mask)));
-
-      coordinates_ANF_all = _mm_and_si128(coordinates_ANF_all, deg2_ind); // if is not deg2
-      deg1_ind = _mm_cmpeq_epi8(_mm_and_si128(coordinates_ANF_all, S3_coors_deg_mask1), zero_128); // is not deg1 0xffff, is deg1 0x0000
-      deg1_cnt = _mm_popcnt_u32(_mm_movemask_epi8(_mm_xor_si128(_mm_and_si128(deg1_ind, S3_coors_ind_mask), S3_coors_ind_mask)));
-
-      deg0_cnt =  N - deg3_cnt - deg2_cnt - deg1_cnt;
-
-      if (deg3_cnt != 0) { max_degree = 3; if (max_degree > max_degree_bound) return false;}
-      else if (deg2_cnt != 0) { max_degree = 2; if (max_degree > max_degree_bound) return false;}
-      else if (deg1_cnt != 0) { max_degree = 1; if (max_degree > max_degree_bound) return false;}
-      else max_degree = 0;
-
-      if (deg0_cnt != 0) { min_degree = 0; if (min_degree < min_degree_bound) return false;}
-      else if (deg1_cnt != 0) { min_degree = 1; if (min_degree < min_degree_bound) return false;}
-      else if (deg2_cnt != 0) { min_degree = 2; if (min_degree < min_degree_bound) return false;}
-      else { min_degree = 3; if (min_degree < min_degree_bound) return false;}
-      return true;
+      int deg_cur = degree_from_ANF(coordinates_ANF[i]);
+      if (deg_cur > max_degree_bound) return false;
+      if (deg_cur < min_degree_bound) return false;
     }
-    else if (N == 4)
-    {
-      __m128i deg4_ind;
-      __m128i deg3_ind;
-      __m128i deg2_ind;
-      __m128i deg1_ind;
-
-      int deg4_cnt = 0; 
-      int deg3_cnt = 0; 
-      int deg2_cnt = 0; 
-      int deg1_cnt = 0; 
-      int deg0_cnt = 0;
-
-      // compute ANF for coordinates
-      array<bit_slice_l_t<N>, N> ALIGNED_(16) coordinates_ANF = {{0}};
-      get_coordinates_ANF(coordinates_ANF);
-      __m128i coordinates_ANF_all = _mm_load_si128((__m128i *)((*coordinates_ANF.data()).data()));
-      coordinates_ANF_all = _mm_xor_si128(coordinates_ANF_all, S4_valv_maskg);
-
-      deg4_ind = _mm_cmpeq_epi16(_mm_and_si128(coordinates_ANF, S4_coors_deg_mask4), zero_128); // is not deg4 0xffff, is deg4 0x0000
-      deg4_cnt = _mm_popcnt_u32(_mm_movemask_epi8(_mm_xor_si128(_mm_and_si128(deg4_ind, S4_coors_ind_mask), S4_coors_ind_mask)));
-
-      coordinates_ANF = _mm_and_si128(coordinates_ANF, deg4_ind); // if is not deg4
-      deg3_ind = _mm_cmpeq_epi16(_mm_and_si128(coordinates_ANF, S4_coors_deg_mask3), zero_128); // is not deg3 0xffff, is deg3 0x0000
-      deg3_cnt = _mm_popcnt_u32(_mm_movemask_epi8(_mm_xor_si128(_mm_and_si128(deg3_ind, S4_coors_ind_mask), S4_coors_ind_mask)));     
-
-      coordinates_ANF = _mm_and_si128(coordinates_ANF, deg3_ind); // if is not deg3
-      deg2_ind = _mm_cmpeq_epi16(_mm_and_si128(coordinates_ANF, S4_coors_deg_mask2), zero_128); // is not deg2 0xffff, is deg2 0x0000
-      deg2_cnt = _mm_popcnt_u32(_mm_movemask_epi8(_mm_xor_si128(_mm_and_si128(deg2_ind, S4_coors_ind_mask), S4_coors_ind_mask)));
-
-      coordinates_ANF = _mm_and_si128(coordinates_ANF, deg2_ind); // if is not deg2
-      deg1_ind = _mm_cmpeq_epi16(_mm_and_si128(coordinates_ANF, S4_coors_deg_mask1), zero_128); // is not deg1 0xffff, is deg1 0x0000
-      deg1_cnt = _mm_popcnt_u32(_mm_movemask_epi8(_mm_xor_si128(_mm_and_si128(deg1_ind, S4_coors_ind_mask), S4_coors_ind_mask)));
-
-      deg0_cnt =  N - deg4_cnt - deg3_cnt - deg2_cnt - deg1_cnt;
-
-      if (deg4_cnt != 0) {max_degree = 4; if (max_degree > max_degree_bound) return false;}
-      else if (deg3_cnt != 0) {max_degree = 3; if (max_degree > max_degree_bound) return false;}
-      else if (deg2_cnt != 0) {max_degree = 2; if (max_degree > max_degree_bound) return false;}
-      else if (deg1_cnt != 0) {max_degree = 1; if (max_degree > max_degree_bound) return false;}
-      else max_degree = 0;
-      
+    return true;
+  }
 
-      if (deg0_cnt != 0) {min_degree = 0; if (min_degree < min_degree_bound) return false;}
-      else if (deg1_cnt != 0) {min_degree = 1; if (min_degree < min_degree_bound) return false;}
-      else if (deg2_cnt != 0) {min_degree = 2; if (min_degree < min_degree_bound) return false;}
-      else if (deg3_cnt != 0) {min_degree = 3; if (min_degree < min_degree_bound) return false;}
-      else {min_degree = 4; if (min_degree < min_degree_bound) return false;}
-      return true;
-    }
-    else if (N <= 8)
+  // Degree spectrum of the components given their ANFs
+  void degree(int deg_spectrum[N+1], int & max_degree, int & min_degree, array<bit_slice_l_t<N>, 1<<N> & components_ANF) const
+  {
+    memset(deg_spectrum, 0, sizeof(int) * (N + 1));
+    max_degree = 0;
+    min_degree = numeric_limits<int>::max();
+    for (int i = 1; i < (1 << N); i++)
     {
-      bit_slice_t<N> coordinates_ANF = bit_slice;
-      get_coordinates_ANF(coordinates_ANF);
-
-      int deg_ind[N + 1] = { 0 };
-      for (int i = 0; i < N; i++)
-      {
-        memset(deg_ind, 0, sizeof(int)*(N + 1));
-        for (int j = 0; j < (1 << N); j++)
-        {
-          deg_ind[_mm_popcnt_u32(j)] |= OPs<N>.get_bit(coordinates_ANF[i], j);
-        }
-        int deg_cur = 0;
-        for (int k = N; k >= 0; k--)
-        {
-          if (deg_ind[k] == 1)
-          {
-            deg_cur = k;
-            break;
-          } 
-        }
-        max_degree = deg_cur > max_degree ? deg_cur : max_degree;
-        if (max_degree > max_degree_bound) return false;
-        min_degree = deg_cur < min_degree ? deg_cur : min_degree;
-        if (min_degree < min_degree_bound) return false;
-      }
-      return true;
+      int deg_cur = degree_from_ANF(components_ANF[i]);
+      deg_spectrum[deg_cur]++;
+      max_degree = deg_cur > max_degree ? deg_cur : max_degree;
+      min_degree = deg_cur < min_degree ? deg_cur : min_degree;
     }
   }
 
@@ -2529,23 +2605,9 @@ struct Peigen::function_t
       array<bit_slice_l_t<N>, 1<<N> components_ANF = {{0}};
       get_components_ANF(components_ANF);
 
-      int deg_ind[N + 1] = { 0 };
       for (int i = 1; i < (1 << N); i++)
       {
-        memset(deg_ind, 0, sizeof(int)*(N + 1));
-        for (int j = 0; j < (1 << N); j++)
-        {
-          deg_ind[_mm_popcnt_u32(j)] |= OPs<N>.get_bit(components_ANF[i], j);
-        }
-        int deg_cur = 0;
-        for (int k = N; k >= 0; k--)
-        {
-          if (deg_ind[k] == 1)
-          {
-            deg_cur = k;
-            break;
-          } 
-        }
+        int deg_cur = degree_from_ANF(components_ANF[i]);
         deg_spectrum[deg_cur]++;
         max_degree = deg_cur > max_degree ? deg_cur : max_degree;
         min_degree = deg_cur < min_degree ? deg_cur : min_degree;
@@ -2555,61 +2617,53 @@ struct Peigen::function_t
 
   int degree_from_ANF(bit_slice_l_t<N> & bf_ANF) const
   {
-    int deg = 0;
-    for (int j = (1 << N) - 1; j > 0; j--)
+    // the highest weight k with a monomial of HWmasks[k] in the ANF
+    for (int k = N; k > 0; k--)
     {
-      if (OPs<N>.get_bit(bf_ANF, HWorder<N>[j]) == 1)
+      bit_slice_l_t<N> terms = bf_ANF & HWmasks<N>[k];
+      for (auto t : terms)
       {
-        deg = _mm_popcnt_u32(HWorder<N>[j]);
-        break;
+        if (t != 0) return k;
       }
     }
-    return deg;
+    return 0;
   }
 
   int degree_from_value(bit_slice_l_t<N> & bf) const
   {
     bit_slice_l_t<N> bf_ANF = bf;
-
-    // compute ANF
-    for (int j = N - 1; j >= 0; j--)
-    {
-      bf_ANF = bf_ANF ^ (OPs<N>.sll(bf_ANF, (1ULL<<j)) & masks<N>[j]);
-    }
-
+    mobius_transform(&bf_ANF, 1);
     return degree_from_ANF(bf_ANF);
   }
 
   int k_product_degree(const int k) const
   {
-    int max_degree = 0;
-    bit_slice_l_t<N> prod_bf = {{}};
-    int end_off = (k == N) ? (1<<N) : HWorder_off<N>[k+1];
-
-    for (int i = 1; i < end_off; i++)
-    {
-      int sel = HWorder<N>[i];
-
-      OPs<N>.set_one_inplace(prod_bf);
-      for (int bi = 0; bi < N; bi++)
-      {
-        if (((sel >> bi) & 1) == 1)
-        {
-            prod_bf = prod_bf & bit_slice[bi];
-        }
-      }
-      int deg = degree_from_value(prod_bf);
-      max_degree = deg > max_degree ? deg : max_degree;
-    }
-    return max_degree;
+    int dkT[N+1];
+    k_product_degree_table(dkT);
+    return dkT[k];
   }
 
   void k_product_degree_table(int dkT[N+1]) const
   {
-    dkT[0] = 0;
-    for (int k = 1; k <= N; k++)
+    array<bit_slice_l_t<N>, 1<<N> products_ANF;
+    get_products_ANF(products_ANF);
+    k_product_degree_table(dkT, products_ANF);
+  }
+
+  // d_k table given the ANFs of the products of coordinates, see get_products_ANF()
+  void k_product_degree_table(int dkT[N+1], array<bit_slice_l_t<N>, 1<<N> & products_ANF) const
+  {
+    // dkT[k] is the max degree of the S^w with 1 <= HW(w) <= k
+    for (int k = 0; k <= N; k++) dkT[k] = 0;
+    for (int w = 1; w < (1<<N); w++)
+    {
+      int hw = _mm_popcnt_u32(w);
+      int deg = degree_from_ANF(products_ANF[w]);
+      dkT[hw] = deg > dkT[hw] ? deg : dkT[hw];
+    }
+    for (int k = 2; k <= N; k++)
     {
-      dkT[k] = k_product_degree(k);
+      dkT[k] = dkT[k-1] > dkT[k] ? dkT[k-1] : dkT[k];
     }
   }
 
@@ -2645,36 +2699,19 @@ struct Peigen::function_t
   {
     int hw = _mm_popcnt_u32(((uint32_t)u) & 0xffU);
     int offset = hw < N ? HWorder_off<N>[hw+1] : (1<<N) + 1;
-    for (int i = 0; i < offset; i++)
-    {
-      uint8_t x = HWorder<N>[i];
-      if ( (x ^ (x & u)) == 0)
-      {
-        uPrec.push_back(x);
-      }      
-    }
-  }
-
-  void get_succ(vector<uint8_t> & uSucc, const uint8_t u) const
-  {
-    int hw = _mm_popcnt_u32(((uint32_t)u) & 0xffU);
-    int offset = HWorder_off<N>[hw];
-    for (int i = offset; i < (1<<N) + 1; i++)
+    for (int i = 0; i < offset; i++)
     {
       uint8_t x = HWorder<N>[i];
-      if ( (u ^ (x & u)) == 0)
+      if ( (x ^ (x & u)) == 0)
       {
-        uSucc.push_back(x);
-      }
+        uPrec.push_back(x);
+      }      
     }
   }
 
   void from_value_to_ANF_inplace(bit_slice_l_t<N> & f_anf) const
   {
-    for (int j = N - 1; j >= 0; j--)
-    {
-      f_anf = f_anf ^ (OPs<N>.sll(f_anf, (1ULL<<j)) & masks<N>[j]);
-    }
+    mobius_transform(&f_anf, 1);
   }
 
   void from_value_to_ANF(bit_slice_l_t<N> & f_anf, const bit_slice_l_t<N> f_val) const
@@ -2683,20 +2720,6 @@ struct Peigen::function_t
     from_value_to_ANF_inplace(f_anf);
   }
 
-  void get_product_of_coordinates_ANF(bit_slice_l_t<N> & S_w, const uint8_t w) const
-  {
-    OPs<N>.set_one_inplace(S_w);
-
-    for (int i = 0; i < N; i++)
-    {
-      if (((w>>i) & 1) == 1)
-      {
-        S_w = S_w & bit_slice[i];
-      }
-    }
-    from_value_to_ANF_inplace(S_w);
-  }
-
   bool is_in_ANF(bit_slice_l_t<N> & S_w, uint8_t u) const
   {
     if (OPs<N>.get_bit(S_w, u) == 1) return true;
@@ -2705,45 +2728,18 @@ struct Peigen::function_t
 
   void V_S_table(int VST[LUT_UNIT_N][LUT_UNIT_N]) const
   {
-    for (int i = 0; i < LUT_UNIT_N; i++)
-    {
-      for (int j = 0; j < LUT_UNIT_N; j++)
-      {
-        VST[i][j] = 0;
-      }
-    }
+    // VST[u][w] = 1 iff some monomial x^v with v a superset of u is in the
+    // ANF of S^w, i.e. bit u of the superset closure of ANF(S^w)
+    array<bit_slice_l_t<N>, 1<<N> products_ANF;
+    get_products_ANF(products_ANF);
+    superset_closure(products_ANF.data(), 1<<N);
 
     for (int u = 0; u < LUT_UNIT_N; u++)
     {
       for (int w = 0; w < LUT_UNIT_N; w++)
       {
-        bit_slice_l_t<N> S_w;
-        get_product_of_coordinates_ANF(S_w, w);
-        if (is_in_ANF(S_w, u))
-        {
-          VST[u][w] = 1;
-        }
-      }
-    }
-
-    vector<uint8_t> uSucc;
-    uSucc.reserve(LUT_UNIT_N);
-    for (int ui = LUT_UNIT_N - 1; ui >= 0; ui--)
-    {
-      uint8_t u = HWorder<N>[ui];
-
-      get_succ(uSucc, u);
-      for (auto v : uSucc)
-      {
-        for (int w = 0; w < LUT_UNIT_N; w++)
-        {
-          if (VST[v][w] == 1)
-          {
-            VST[u][w] = 1;
-          }
-        }
+        VST[u][w] = OPs<N>.get_bit(products_ANF[w], u);
       }
-      uSucc.clear();
     }
   }
 
@@ -2778,13 +2774,74 @@ struct Peigen::function_t
 
   void autocorrelation_matrix(int ACT[LUT_UNIT_N][LUT_UNIT_N]) const
   {
-    int DDT[LUT_UNIT_N][LUT_UNIT_N];
-    int Diff;
-    int DDT_spectrum[LUT_UNIT_N+1];
-    int Diff1;
-    int DDT1_spectrum[LUT_UNIT_N+1];
+    #ifndef NFWHT
+    if (N <= 8)
+    {
+      ALIGNED_TYPE_(int16_t, 32) W[LUT_UNIT_N][WALSH_YMM_N * 16];
+      walsh_spectrum(W);
+      autocorrelation_matrix(ACT, W);
+    }
+    else
+    #endif
+    {
+      int DDT[LUT_UNIT_N][LUT_UNIT_N];
+      int Diff;
+      int DDT_spectrum[LUT_UNIT_N+1];
+      int Diff1;
+      int DDT1_spectrum[LUT_UNIT_N+1];
 
-    difference_distribution_matrix(DDT, Diff, DDT_spectrum, Diff1, DDT1_spectrum);
+      difference_distribution_matrix(DDT, Diff, DDT_spectrum, Diff1, DDT1_spectrum);
+      autocorrelation_matrix(ACT, DDT);
+    }
+  }
+
+  // !!! Only applicable for N = 3, 4, 5, 6, 7, 8
+  // ACT from the Walsh spectrum W of walsh_spectrum() (Wiener-Khinchin): the
+  // autocorrelation of the component b is the WHT of its squared Walsh
+  // coefficients, ACT[a][b] = 2^-N sum_u (-1)^(a.u) W[u][b]^2.
+  // The WHT runs over u on whole rows, 8 components per __m256i, O(N 2^2N).
+  void autocorrelation_matrix(int ACT[LUT_UNIT_N][LUT_UNIT_N], const int16_t W[LUT_UNIT_N][WALSH_YMM_N * 16]) const
+  {
+    for (int u = 0; u < LUT_UNIT_N; u++)
+    {
+      for (int b = 0; b < LUT_UNIT_N; b += 8)
+      {
+        __m256i w = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *)(W[u] + b)));
+        _mm256_storeu_si256((__m256i *)(ACT[u] + b), _mm256_mullo_epi32(w, w));
+      }
+    }
+
+    for (int h = 1; h < LUT_UNIT_N; h <<= 1)
+    {
+      for (int i = 0; i < LUT_UNIT_N; i += (h << 1))
+      {
+        for (int u = i; u < i + h; u++)
+        {
+          for (int b = 0; b < LUT_UNIT_N; b += 8)
+          {
+            __m256i t0 = _mm256_loadu_si256((const __m256i *)(ACT[u] + b));
+            __m256i t1 = _mm256_loadu_si256((const __m256i *)(ACT[u + h] + b));
+            _mm256_storeu_si256((__m256i *)(ACT[u] + b), _mm256_add_epi32(t0, t1));
+            _mm256_storeu_si256((__m256i *)(ACT[u + h] + b), _mm256_sub_epi32(t0, t1));
+          }
+        }
+      }
+    }
+
+    // exact, 2^N divides every entry
+    for (int a = 0; a < LUT_UNIT_N; a++)
+    {
+      for (int b = 0; b < LUT_UNIT_N; b += 8)
+      {
+        __m256i t = _mm256_loadu_si256((const __m256i *)(ACT[a] + b));
+        _mm256_storeu_si256((__m256i *)(ACT[a] + b), _mm256_srai_epi32(t, N));
+      }
+    }
+  }
+
+  // ACT given the DDT of the S-box
+  void autocorrelation_matrix(int ACT[LUT_UNIT_N][LUT_UNIT_N], const int DDT[LUT_UNIT_N][LUT_UNIT_N]) const
+  {
     OPs<N>.mulHM(ACT, DDT);
   }
 
@@ -2807,9 +2864,15 @@ struct Peigen::function_t
 
   int linear_structures(vector<tuple<int, int, int> > & LS) const
   {
-    LS.clear();
     int ACT[LUT_UNIT_N][LUT_UNIT_N];
     autocorrelation_matrix(ACT);
+    return linear_structures(LS, ACT);
+  }
+
+  // Linear structures given the ACT of the S-box
+  int linear_structures(vector<tuple<int, int, int> > & LS, const int ACT[LUT_UNIT_N][LUT_UNIT_N]) const
+  {
+    LS.clear();
 
     for (int ci = 1; ci < (1<<N); ci++)
     {
@@ -2856,6 +2919,13 @@ struct Peigen::function_t
     return LS.size();
   }
 
+  int number_linear_structures(const int ACT[LUT_UNIT_N][LUT_UNIT_N]) const
+  {
+    vector<tuple<int, int, int> > LS;
+    linear_structures(LS, ACT);
+    return LS.size();
+  }
+
   // require: bf be the ANF of a Boolean function, instead of the value vector
   bool is_linear(const bit_slice_l_t<N> & bf) const
   {
@@ -2933,206 +3003,145 @@ struct Peigen::function_t
     return ss.str();
   }
 
-  void v_w_linear(vector<pair<vector<uint8_t>, vector<uint8_t>> > & VW, int VW_n[N][N]) const
+  // Reduces d against pivot[] (pivot[k] has leading bit k), adds it if it is
+  // independent and returns the new rank
+  static int v_w_reduce(uint8_t pivot[N], int rank, uint8_t d)
   {
-    memset(VW_n, 0, N * N * sizeof(int));
-
-    array<array<uint8_t, LUT_UNIT_N>, 1<<N > components_LUT;
-    get_components_LUT(components_LUT);
-
-    bool testnextV = false;
-
-    vector<uint8_t> WholeSpaces;
-    for (int i = 0; i < (1<<N); i++)
+    for (int k = N - 1; k >= 0; k--)
     {
-      WholeSpaces.push_back(i);
+      if (((d >> k) & 1) == 0) continue;
+      if (pivot[k] == 0)
+      {
+        pivot[k] = d;
+        return rank + 1;
+      }
+      d ^= pivot[k];
     }
+    return rank;
+  }
 
-    array<bool, N> existWwithDw;
-    vector<uint8_t> V;
-    vector<uint8_t> V_span;
-    vector<uint8_t> cV_span;
-    array<bool, 1<<N > components_isLinear;
-    set<uint8_t> linearComponents;
-    vector<vector<uint8_t> > Ws;
-    vector<uint8_t> appended;
-
-    for (int v = N - 1; v > 0; v--)
-    { // enumerate on the dimension of V
-      int vn = SubSpaces<N>[v - 1].size();
-      // for (int vi = 0; vi < vn; vi++)
-      for (int vi = 0; vi < vn; vi++)
-      { // enumerate Subspaces V with dimension vi
-        
-        existWwithDw.fill(false);
-        testnextV = false;
-        
-        V.clear();
-        V_span.clear();
-
-        V = SubSpaces<N>[v - 1][vi];
-        V_span.push_back(0);
-        for (int x = 1; x < (1 << v); x++)
+  // For every pair a < b, the span of the second derivatives D_a D_b S(x)
+  // over all x, as N pivots at pair_span[(a * 2^N + b) * N]
+  void v_w_pair_spans(vector<uint8_t> & pair_span) const
+  {
+    const uint8_t * S = (const uint8_t *) LUT;
+    pair_span.assign((size_t)LUT_UNIT_N * LUT_UNIT_N * N, 0);
+    for (int a = 1; a < LUT_UNIT_N; a++)
+    {
+      for (int b = a + 1; b < LUT_UNIT_N; b++)
+      {
+        uint8_t * pivot = pair_span.data() + ((size_t)a * LUT_UNIT_N + b) * N;
+        bit_slice_l_t<N> seen = {{0}};
+        OPs<N>.set_bit_inplace(seen, 0);
+        int rank = 0;
+        for (int x = 0; (x < LUT_UNIT_N) && (rank < N); x++)
         {
-          uint8_t V_element = 0;
-          for (int i = 0; i < v; i++)
-          {
-            if ((x >> i) & 1) V_element ^= V[i];
-          }
-          V_span.push_back(V_element);
+          uint8_t d = S[x] ^ S[x ^ a] ^ S[x ^ b] ^ S[x ^ a ^ b];
+          if (OPs<N>.get_bit(seen, d)) continue;
+          OPs<N>.set_bit_inplace(seen, d);
+          rank = v_w_reduce(pivot, rank, d);
         }
-        std::sort(V_span.begin(), V_span.end());
-
-        cV_span.clear();
-        cV_span.reserve((1<<N) - (1<<v) + 1);
-        cV_span[0] = 0;
-        std::set_difference(WholeSpaces.begin(), WholeSpaces.end(), V_span.begin(), V_span.end(), cV_span.begin() + 1);
-
-        int isLinearCompN = (1<<N) - 1;
-        components_isLinear.fill(true);
-
-        for (int cvi = 0; cvi <= ((1<<N) - (1<<v)); cvi++)
-        { // forall a, generate coset $ a + V $, at the same time, testing whether each component is linear on this coset
-          uint8_t cV_element = cV_span[cvi];
+      }
+    }
+  }
 
-          for (int avi = 1; avi < (1 << v); avi++)
-          {
-            uint8_t aV_element = 0;
-            for (int i = 0; i < v; i++)
-            {
-              if ((avi >> i) & 1)
-              {
-                for (int compi = 1; compi < (1<<N); compi++)
-                {
-                  if (components_isLinear[compi] == true)
-                  {
-                    if (
-                    (components_LUT[compi][cV_element] ^ components_LUT[compi][cV_element ^ aV_element] ^ components_LUT[compi][cV_element ^ V[i]]) !=
-                     components_LUT[compi][cV_element ^ aV_element ^ V[i]])
-                    {
-                      components_isLinear[compi] = false;
-                      isLinearCompN--;
-                      if (isLinearCompN == 0)
-                      {
-                        testnextV = true;
-                        break;
-                      }
-                    }
-                  }
-                }
-                if (testnextV) break;
-                aV_element ^= V[i];
-              }
-            }
-            if (testnextV) break;
-          }
-          if (testnextV) break;          
+  // The components b.S affine on every coset of span(V) are the b orthogonal
+  // to all the second derivatives D_{V[i]} D_{V[j]} S(x), i < j. Puts in
+  // pivot[k] a basis of their span with leading bit k (0 if none) and returns
+  // its rank, stopping as soon as it is N, i.e. no component is left.
+  int v_w_derivative_span(const vector<uint8_t> & V, const vector<uint8_t> & pair_span, uint8_t pivot[N]) const
+  {
+    memset(pivot, 0, N);
+    int rank = 0;
+    int v = V.size();
+    for (int i = 0; i < v; i++)
+    {
+      for (int j = i + 1; j < v; j++)
+      {
+        int a = V[i] < V[j] ? V[i] : V[j];
+        int b = V[i] ^ V[j] ^ a;
+        const uint8_t * ab_pivot = pair_span.data() + ((size_t)a * LUT_UNIT_N + b) * N;
+        for (int k = N - 1; k >= 0; k--)
+        {
+          if (ab_pivot[k] == 0) continue;
+          rank = v_w_reduce(pivot, rank, ab_pivot[k]);
+          if (rank == N) return rank;
         }
+      }
+    }
+    return rank;
+  }
 
-        if (testnextV == false)
-        { // after testing all coset of V, there exist componets remains linear
+  // The components orthogonal to the pivots, listed in the order the
+  // original greedy grouping produced: the smallest one c first, then
+  // each next smallest c' followed by c' ^ w for the w listed so far
+  void v_w_components(const uint8_t pivot[N], vector<uint8_t> & W) const
+  {
+    bit_slice_l_t<N> Wset = {{0}};
+    for (int c = 1; c < (1<<N); c++)
+    {
+      bool orth = true;
+      for (int k = 0; k < N; k++)
+      {
+        if (_mm_popcnt_u32(c & pivot[k]) & 1) { orth = false; break; }
+      }
+      if (orth) OPs<N>.set_bit_inplace(Wset, c);
+    }
 
-          linearComponents.clear();
-          for (int compi = 1; compi < (1<<N); compi++)
-          {
-            if (components_isLinear[compi])
-            {
-              linearComponents.insert(compi);
-            }
-          }
+    W.clear();
+    bit_slice_l_t<N> listed = {{0}};
+    for (int c = 1; c < (1<<N); c++)
+    {
+      if (!OPs<N>.get_bit(Wset, c) || OPs<N>.get_bit(listed, c)) continue;
+      int Wn = W.size();
+      W.push_back(c);
+      OPs<N>.set_bit_inplace(listed, c);
+      for (int wi = 0; wi < Wn; wi++)
+      {
+        W.push_back(c ^ W[wi]);
+        OPs<N>.set_bit_inplace(listed, c ^ W[wi]);
+      }
+    }
+  }
 
-          Ws.clear();
-          while (linearComponents.size() != 0)
-          {
-            auto linearComp_it = linearComponents.begin();
-            uint8_t curComp = *linearComp_it;
+  // Largest w (at most N - 1) such that S is (v, w)-linear w.r.t. some V of
+  // dimension v, 0 if none; stops as soon as w reaches stop_w
+  int v_w_linear_best_w(int v, int stop_w, const vector<uint8_t> & pair_span) const
+  {
+    int best_w = 0;
+    uint8_t pivot[N];
+    for (const auto & V : SubSpaces<N>()[v - 1])
+    {
+      int w = N - v_w_derivative_span(V, pair_span, pivot);
+      w = w < N - 1 ? w : N - 1;
+      best_w = w > best_w ? w : best_w;
+      if (best_w >= stop_w) break;
+    }
+    return best_w;
+  }
 
-            if (Ws.size() == 0)
-            {
-              Ws.push_back({curComp});
-              linearComponents.erase(curComp);
-            }
-            else
-            {
-              bool indp = true;
-              auto Ws_it = Ws.begin();
-              while (Ws_it != Ws.end())
-              {
-                bool canFormSubspace = true;
-                appended.clear();
-                appended.push_back(curComp);
-
-                auto W_it = (*Ws_it).begin();
-                while (W_it != (*Ws_it).end())
-                {
-                  uint8_t preComp = *W_it;
-                  uint8_t linearComb = curComp ^ preComp;
-
-                  auto linearCombp = linearComponents.find(linearComb);
-                  if (linearCombp == linearComponents.end())
-                  {
-                    canFormSubspace = false;
-                    break;
-                  }
-                  else
-                  {
-                    appended.push_back(linearComb);
-                  }
-                  W_it++;
-                }
-                if (canFormSubspace)
-                {
-                  indp = false;
-                  auto new_it = appended.begin();
-                  while (new_it != appended.end())
-                  {
-                    uint8_t new_elem = *new_it;
-                    (*Ws_it).push_back(new_elem);
-                    linearComponents.erase(new_elem);
-                    new_it++;
-                  }
-                  appended.clear();
-                  appended.shrink_to_fit();
-                  break;
-                }
-                else
-                {
-                  appended.clear();
-                  appended.shrink_to_fit();
-                }
-                Ws_it++;
-              }
+  void v_w_linear(vector<pair<vector<uint8_t>, vector<uint8_t>> > & VW, int VW_n[N][N]) const
+  {
+    memset(VW_n, 0, N * N * sizeof(int));
 
-              if (indp)
-              {
-                Ws.push_back({curComp});
-                linearComponents.erase(curComp);
-              }
-            }            
-          }
+    vector<uint8_t> pair_span;
+    v_w_pair_spans(pair_span);
 
-          auto Ws_it = Ws.begin();
-          while (Ws_it != Ws.end())
-          {
-            int Wn = (*Ws_it).size() + 1;
-            float wf = log2((float)Wn);
-            float wf_intpart;
-            float wf_fracpart = modf(wf, &wf_intpart);
-            int w = (int)wf_intpart;
-            VW.push_back(pair<vector<uint8_t>, vector<uint8_t> > (V, (*Ws_it)));
-
-            for (int wi = 1; wi <= w; wi++)
-            {
-              existWwithDw[wi] = true;
-            }
-            Ws_it++;
-          }
-          
-          Ws.clear();
-          for (int w = 1; w < N; w++)
-          {
-            if (existWwithDw[w]) VW_n[v][w]++;
-          }
+    uint8_t pivot[N];
+    vector<uint8_t> W;
+    W.reserve(1<<N);
+    for (int v = N - 1; v > 0; v--)
+    { // enumerate on the dimension of V
+      for (const auto & V : SubSpaces<N>()[v - 1])
+      {
+        int rank = v_w_derivative_span(V, pair_span, pivot);
+        if (rank == N) continue;
+
+        v_w_components(pivot, W);
+        VW.push_back(pair<vector<uint8_t>, vector<uint8_t> > (V, W));
+        for (int w = 1; (w <= N - rank) && (w < N); w++)
+        {
+          VW_n[v][w]++;
         }
       }
     }
@@ -3193,44 +3202,42 @@ struct Peigen::function_t
 
   void max_v_w_linear(pair<int, int> & max_v, pair<int, int> & max_w) const
   {
-    vector<pair<vector<uint8_t>, vector<uint8_t>> > VW;
-    int VW_n[N][N];
-    v_w_linear(VW, VW_n);
+    // best_w[v] = the largest w over the V of dimension v, it can only grow
+    // when V shrinks (a component affine on the cosets of V is on those of
+    // its subspaces), so only the dimensions needed are scanned, in
+    // decreasing order, and each scan stops once the bound is reached
+    int best_w[N];
+    for (int v = 0; v < N; v++) best_w[v] = -1;
+
+    vector<uint8_t> pair_span;
+    v_w_pair_spans(pair_span);
 
     max_v.first = 0;
     max_v.second = 0;
-    bool find = false;
     for (int v = N - 1; v > 0; v--)
     {
-      for (int w = N - 1; w > 0; w--)
+      best_w[v] = v_w_linear_best_w(v, N - 1, pair_span);
+      if (best_w[v] != 0)
       {
-        if (VW_n[v][w] != 0)
-        {
-          find = true;
-          max_v.first = v;
-          max_v.second = w;
-          break;
-        }
+        max_v.first = v;
+        max_v.second = best_w[v];
+        break;
       }
-      if (find) break;
     }
 
     max_w.first = 0;
     max_w.second = 0;
-    find = false;
-    for (int w = N - 1; w > 0; w--)
+    int top_w = best_w[1] != -1 ? best_w[1] : v_w_linear_best_w(1, N - 1, pair_span);
+    if (top_w == 0) return;
+    for (int v = N - 1; v > 0; v--)
     {
-      for (int v = N - 1; v > 0; v--)
+      int w = best_w[v] != -1 ? best_w[v] : v_w_linear_best_w(v, top_w, pair_span);
+      if (w >= top_w)
       {
-        if (VW_n[v][w] != 0)
-        {
-          find = true;
-          max_w.first = v;
-          max_w.second = w;
-          break;
-        }
+        max_w.first = v;
+        max_w.second = top_w;
+        break;
       }
-      if (find) break;
     }
   }
 
@@ -3269,15 +3276,17 @@ struct Peigen::function_t
     Set_t GB = {{ 0 }};
     uint8_t GS_old = 0;
 
-    stack<Set_t> UA_stack;
-    stack<Set_t> UB_stack;
-    stack<Set_t> CA_stack;
-    stack<Set_t> CB_stack;
-    stack<Set_t> GA_stack;
-    stack<Set_t> GB_stack;
-    stack<uint8_t> GS_stack;
-    stack<array<uint8_t, LUT_UNIT_N> > LA_stack;
-    stack<array<uint8_t, LUT_UNIT_N> > LB_stack;
+    // frames[0..top]: the state before each pending guess, and the guess GS
+    // made from it. The determined inputs CA form a subspace doubled by each
+    // guess and never full when guessing, so at most N frames are live.
+    struct frame_t
+    {
+      Set_t UA, UB, CA, CB, GA, GB;
+      array<uint8_t, LUT_UNIT_N> LA, LB;
+      uint8_t GS;
+    };
+    frame_t frames[N];
+    int top = -1;
 
     OPs<N>.set_one_inplace(UA); OPs<N>.unset_bit_inplace(UA, 0);
     OPs<N>.set_one_inplace(UB); OPs<N>.unset_bit_inplace(UB, 0);
@@ -3289,15 +3298,6 @@ struct Peigen::function_t
     memset(LA.data(), 0, sizeof(uint8_t) * LUT_UNIT_N);
     memset(LB.data(), 0, sizeof(uint8_t) * LUT_UNIT_N);
 
-    UA_stack.push(UA);
-    UB_stack.push(UB);
-    CA_stack.push(CA);
-    CB_stack.push(CB);
-    GA_stack.push(GA);
-    GB_stack.push(GB);
-    LA_stack.push(LA);
-    LB_stack.push(LB);
-    GS_stack.push(0);
 
     bool all_rejected = false;
     bool last_rejected = false;
@@ -3306,19 +3306,12 @@ struct Peigen::function_t
     {
       if (all_rejected)
       {
-        if (UA_stack.size() == 1)
+        if (top == 0)
         {
           return false;
         } 
         PRINT(cout << "if (all_rejected)" << endl);
-        UA_stack.pop();
-        UB_stack.pop();
-        CA_stack.pop();
-        CB_stack.pop();
-        GA_stack.pop();
-        GB_stack.pop();
-        LA_stack.pop();
-        LB_stack.pop();
+        top--;
         NA = Z;
         NB = Z;
         all_rejected = false;
@@ -3330,16 +3323,13 @@ struct Peigen::function_t
         if (last_rejected)
         {
           PRINT(cout << "if (last_rejected)" << endl);
-          UA = UA_stack.top();
-          UB = UB_stack.top();
-          CA = CA_stack.top();
-          CB = CB_stack.top();
-          GA = GA_stack.top();
-          GB = GB_stack.top();
-          LA = LA_stack.top();
-          LB = LB_stack.top();
+          const frame_t & F = frames[top];
+          UA = F.UA; UB = F.UB;
+          CA = F.CA; CB = F.CB;
+          GA = F.GA; GB = F.GB;
+          LA = F.LA; LB = F.LB;
 
-          GS_old = GS_stack.top(); GS_stack.pop();
+          GS_old = F.GS;
 
           uint8_t x = OPs<N>.lsb_idx(UA);
           PRINT(cout << "Reject Guess: LA[" << x + '\0' << "] = " << GS_old + '\0'  << endl);       
@@ -3354,7 +3344,7 @@ struct Peigen::function_t
           {
             LA[x] = next_guess;
             PRINT(cout << "Guess: LA[" << x + '\0'  << "] = " << LA[x] + '\0'  << endl);
-            GS_stack.push(next_guess);
+            frames[top].GS = next_guess;
             OPs<N>.unset_bit_inplace(GA, next_guess);
             OPs<N>.set_bit_inplace(NA, x);
             OPs<N>.unset_bit_inplace(UA, x);
@@ -3363,20 +3353,17 @@ struct Peigen::function_t
         }
         else
         {
-          UA_stack.push(UA);
-          UB_stack.push(UB);
-          CA_stack.push(CA);
-          CB_stack.push(CB);
-          GA_stack.push(GA);
-          GB_stack.push(GB);
-          LA_stack.push(LA);
-          LB_stack.push(LB);
+          frame_t & F = frames[++top];
+          F.UA = UA; F.UB = UB;
+          F.CA = CA; F.CB = CB;
+          F.GA = GA; F.GB = GB;
+          F.LA = LA; F.LB = LB;
 
           uint8_t x = OPs<N>.lsb_idx(UA);
           uint8_t y = OPs<N>.lsb_idx(GA);
           LA[x] = y;
           PRINT(cout << "Guess: LA[" << x + '\0'  << "] = " << y + '\0'  << endl);
-          GS_stack.push(y);
+          frames[top].GS = y;
           OPs<N>.unset_bit_inplace(GA, y);
           OPs<N>.set_bit_inplace(NA, x);
           OPs<N>.unset_bit_inplace(UA, x);
@@ -3682,10 +3669,10 @@ struct Peigen::function_t
     function_t<N> func_perm_po;
     for (int ip = 0; ip < FACT_(N); ip++)
     {
-      OPs<N>.composite(func_perm_pi.LUT, LUT, PE<N>.func[ip].LUT);
+      OPs<N>.composite(func_perm_pi.LUT, LUT, PE<N>().func[ip].LUT);
       for (int op = 0; op < FACT_(N); op++)
       {     
-        OPs<N>.composite(func_perm_po.LUT, PE<N>.func[op].LUT, func_perm_pi.LUT);            
+        OPs<N>.composite(func_perm_po.LUT, PE<N>().func[op].LUT, func_perm_pi.LUT);            
         func_perm_po.LUT_to_bit_slice();
         PEmap.insert(pair<function_t<N>, int >(func_perm_po, (ip<<16)|(op<<8)));
       }
@@ -3719,11 +3706,11 @@ struct Peigen::function_t
     function_t<N> func_perm_xi;
     for (int ix = 0; ix < (1<<N); ix++)
     {
-      OPs<N>.composite(func_perm_xi.LUT, LUT, XE<N>[ix].LUT);
+      OPs<N>.composite(func_perm_xi.LUT, LUT, XE<N>()[ix].LUT);
       for (int ox = 0; ox < (1<<N); ox++)
       {
         function_t<N> func_comp;    
-        OPs<N>.composite(func_comp.LUT, XE<N>[ox].LUT, func_perm_xi.LUT);       
+        OPs<N>.composite(func_comp.LUT, XE<N>()[ox].LUT, func_perm_xi.LUT);       
         func_comp.LUT_to_bit_slice();
         XEmap.insert(pair<function_t<N>, int >(func_comp, (ix<<24)|ox));
       }   
@@ -3755,14 +3742,14 @@ struct Peigen::function_t
     function_t func_min;
     function_t func_perm;
 
-    OPs<N>.composite(func_perm.LUT, LUT, PE<N>.func[0].LUT);
+    OPs<N>.composite(func_perm.LUT, LUT, PE<N>().func[0].LUT);
     func_perm.LUT_to_bit_slice();
     func_perm.sort();
     func_min = func_perm;
 
     for (int ip = 1; ip < FACT_(N); ip++)
     {
-      OPs<N>.composite(func_perm.LUT, LUT, PE<N>.func[ip].LUT);
+      OPs<N>.composite(func_perm.LUT, LUT, PE<N>().func[ip].LUT);
       func_perm.LUT_to_bit_slice();
       func_perm.sort();
       func_min = (func_perm < func_min) ? func_perm : func_min;
@@ -3782,15 +3769,15 @@ struct Peigen::function_t
     {
       for (int ip = 0; ip < FACT_(N); ip++)
       {
-        OPs<N>.composite(func_perm_xi.LUT, PE<N>.func[ip].LUT, XE<N>[ix].LUT);
+        OPs<N>.composite(func_perm_xi.LUT, PE<N>().func[ip].LUT, XE<N>()[ix].LUT);
         OPs<N>.composite(func_perm_pi.LUT, LUT, func_perm_xi.LUT);
         for (int op = 0; op < FACT_(N); op++)
         {     
-          OPs<N>.composite(func_perm_po.LUT, PE<N>.func[op].LUT, func_perm_pi.LUT);            
+          OPs<N>.composite(func_perm_po.LUT, PE<N>().func[op].LUT, func_perm_pi.LUT);            
           for (int ox = 0; ox < (1<<N); ox++)
           {
             function_t<N> func_comp;    
-            OPs<N>.composite(func_comp.LUT, XE<N>[ox].LUT, func_perm_po.LUT);       
+            OPs<N>.composite(func_comp.LUT, XE<N>()[ox].LUT, func_perm_po.LUT);       
             func_comp.LUT_to_bit_slice();
             PXEmap.insert(pair<function_t<N>, int >(func_comp, (ix<<24)|(ip<<16)|(op<<8)|ox));
           }   
@@ -3832,15 +3819,15 @@ struct Peigen::function_t
     {
       for (int ip = 0; ip < FACT_(N); ip++)
       {
-        OPs<N>.composite(func_perm_xi.LUT, PE<N>.func[ip].LUT, XE<N>[ix].LUT);
+        OPs<N>.composite(func_perm_xi.LUT, PE<N>().func[ip].LUT, XE<N>()[ix].LUT);
         OPs<N>.composite(func_perm_pi.LUT, LUT, func_perm_xi.LUT);
         for (int op = 0; op < FACT_(N); op++)
         {     
-          OPs<N>.composite(func_perm_po.LUT, PE<N>.func[op].LUT, func_perm_pi.LUT);            
+          OPs<N>.composite(func_perm_po.LUT, PE<N>().func[op].LUT, func_perm_pi.LUT);            
           for (int ox = 0; ox < (1<<N); ox++)
           {
             function_t<N> func_comp;    
-            OPs<N>.composite(func_comp.LUT, XE<N>[ox].LUT, func_perm_po.LUT);       
+            OPs<N>.composite(func_comp.LUT, XE<N>()[ox].LUT, func_perm_po.LUT);       
             func_comp.LUT_to_bit_slice();
             func_min = (func_comp < func_min) ? func_comp : func_min;
           }   
@@ -3850,12 +3837,27 @@ struct Peigen::function_t
     return func_min;
   }
 
+  // LE_representative() looks the permutation up in LE_cache<N>() first,
+  // a permutation met before skips the backtracking search
   void LE_representative(uint8_t RS[LUT_UNIT_N], uint8_t A[LUT_UNIT_N], uint8_t B[LUT_UNIT_N]) const
   {
     if (!is_permutation())
     {
       return;
     }
+    if (LE_cache<N>().find((uint8_t *)LUT, RS, A, B)) return;
+    LE_representative_search(RS, A, B);
+    LE_cache<N>().insert((uint8_t *)LUT, RS, A, B);
+  }
+
+  // Given a bound, only an RS not greater than bound is looked for, false
+  // is returned (and RS, A and B are left as they are) when there is none
+  bool LE_representative_search(uint8_t RS[LUT_UNIT_N], uint8_t A[LUT_UNIT_N], uint8_t B[LUT_UNIT_N], const uint8_t * bound = NULL) const
+  {
+    if (!is_permutation())
+    {
+      return false;
+    }
     PRINT(cout << __LINE__ << endl);
 
     typedef bit_slice_l_t<N> Set_t;
@@ -3871,29 +3873,25 @@ struct Peigen::function_t
     array<uint8_t, LUT_UNIT_N> min_LR;
     array<uint8_t, LUT_UNIT_N> min_LA;
     array<uint8_t, LUT_UNIT_N> min_LB;
-    min_LR.fill(numeric_limits<uint8_t>::max());
+    if (bound != NULL) memcpy(min_LR.data(), bound, sizeof(uint8_t) * LUT_UNIT_N);
+    else min_LR.fill(numeric_limits<uint8_t>::max());
+    bool found = false;
 
     Set_t UA, UB, UR, DA, DB, DR, CA, CB, NA, NB, GA, GB, GR;
     array<uint8_t, LUT_UNIT_N> LR, LA, LB, iLA, iLB;
     uint8_t GS_old = 0;
 
-    vector<Set_t> UA_stack;
-    vector<Set_t> UB_stack;
-    vector<Set_t> UR_stack;
-    vector<Set_t> DA_stack;
-    vector<Set_t> DB_stack;
-    vector<Set_t> DR_stack;
-    vector<Set_t> CA_stack;
-    vector<Set_t> CB_stack;
-    vector<Set_t> GA_stack;
-    vector<Set_t> GB_stack;
-    vector<Set_t> GR_stack;
-    vector<uint8_t> GS_stack;
-    vector<array<uint8_t, LUT_UNIT_N> > LR_stack;
-    vector<array<uint8_t, LUT_UNIT_N> > LA_stack;
-    vector<array<uint8_t, LUT_UNIT_N> > LB_stack;
-    vector<array<uint8_t, LUT_UNIT_N> > iLA_stack;
-    vector<array<uint8_t, LUT_UNIT_N> > iLB_stack;
+    // frames[0..top]: the state before each pending guess, and the guess GS
+    // made from it. The span DA of the inputs determined in LA is doubled by
+    // each guess and never full when guessing, so at most N frames are live.
+    struct frame_t
+    {
+      Set_t UA, UB, UR, DA, DB, DR, CA, CB, GA, GB, GR;
+      array<uint8_t, LUT_UNIT_N> LR, LA, LB, iLA, iLB;
+      uint8_t GS;
+    };
+    frame_t frames[N];
+    int top = -1;
 
     UA.fill(UINT_MAX); OPs<N>.unset_bit_inplace(UA, 0);
     UB.fill(UINT_MAX); OPs<N>.unset_bit_inplace(UB, 0);
@@ -3925,62 +3923,25 @@ struct Peigen::function_t
       GR.fill(UINT_MAX);
     }
 
-    GS_stack.push_back(0);
-    UA_stack.push_back(UA);
-    UB_stack.push_back(UB);
-    UR_stack.push_back(UR);
-    DA_stack.push_back(DA);
-    DB_stack.push_back(DB);
-    DR_stack.push_back(DR);
-    CA_stack.push_back(CA);
-    CB_stack.push_back(CB);
-    GA_stack.push_back(GA);
-    GB_stack.push_back(GB);
-    GR_stack.push_back(GR);
-    LR_stack.push_back(LR);
-    LA_stack.push_back(LA);
-    LB_stack.push_back(LB);
-    iLA_stack.push_back(iLA);
-    iLB_stack.push_back(iLB);
 
     bool all_rejected = false;
     bool last_rejected = false;
     bool try_next = true;
 
-    PRINT(cout << "GS_stack.size(): " << GS_stack.size() << " at line: " << __LINE__ << endl);
-    PRINT(cout << "UA_stack.size(): " << UA_stack.size() << " at line: " << __LINE__ << endl);
+    PRINT(cout << "top: " << top << " at line: " << __LINE__ << endl);
 
     while ((((UA != Z) && (UB != Z)) || all_rejected) || try_next)
     {
       try_next = false;
       if (all_rejected)
       {
-        PRINT(cout << "GS_stack.size(): " << GS_stack.size() << " at line: " << __LINE__  << endl);
-        PRINT(cout << "UA_stack.size(): " << UA_stack.size() << " at line: " << __LINE__  << endl);
-        if (GS_stack.size() == 1)
+        PRINT(cout << "top: " << top << " at line: " << __LINE__  << endl);
+        if (top == 0)
         {
-          memcpy(RS, min_LR.data(), sizeof(uint8_t) * LUT_UNIT_N);
-          memcpy(A, min_LA.data(), sizeof(uint8_t) * LUT_UNIT_N);
-          memcpy(B, min_LB.data(), sizeof(uint8_t) * LUT_UNIT_N);
-          return;
+          break;
         } 
         PRINT(cout << "if (all_rejected)" << endl);
-        UA_stack.pop_back();
-        UB_stack.pop_back();
-        UR_stack.pop_back();
-        DA_stack.pop_back();
-        DB_stack.pop_back();
-        DR_stack.pop_back();
-        CA_stack.pop_back();
-        CB_stack.pop_back();
-        GA_stack.pop_back();
-        GB_stack.pop_back();
-        GR_stack.pop_back();
-        LR_stack.pop_back();
-        LA_stack.pop_back();
-        LB_stack.pop_back();
-        iLA_stack.pop_back();
-        iLB_stack.pop_back();
+        top--;
         NA = Z; NB = Z;
         all_rejected = false;
         last_rejected = true;
@@ -3994,24 +3955,14 @@ struct Peigen::function_t
         if (last_rejected)
         {
           PRINT(cout << "if (last_rejected)" << endl);
-          UA = UA_stack.back();
-          UB = UB_stack.back();
-          UR = UR_stack.back();
-          DA = DA_stack.back();
-          DB = DB_stack.back();
-          DR = DR_stack.back();
-          CA = CA_stack.back();
-          CB = CB_stack.back();
-          GA = GA_stack.back();
-          GB = GB_stack.back();
-          GR = GR_stack.back();
-          LR = LR_stack.back();
-          LA = LA_stack.back();
-          LB = LB_stack.back();
-          iLA = iLA_stack.back();
-          iLB = iLB_stack.back();
-
-          GS_old = GS_stack.back(); GS_stack.pop_back();
+          const frame_t & F = frames[top];
+          UA = F.UA; UB = F.UB; UR = F.UR;
+          DA = F.DA; DB = F.DB; DR = F.DR;
+          CA = F.CA; CB = F.CB;
+          GA = F.GA; GB = F.GB; GR = F.GR;
+          LR = F.LR; LA = F.LA; LB = F.LB; iLA = F.iLA; iLB = F.iLB;
+
+          GS_old = F.GS;
 
           x = OPs<N>.lsb_idx(UA);
           PRINT(cout << "Reject Guess: LA[" << x + '\0' << "] = " << GS_old + '\0'  << endl);       
@@ -4030,22 +3981,12 @@ struct Peigen::function_t
         }
         else
         {
-          UA_stack.push_back(UA);
-          UB_stack.push_back(UB);
-          UR_stack.push_back(UR);
-          DA_stack.push_back(DA);
-          DB_stack.push_back(DB);
-          DR_stack.push_back(DR);
-          CA_stack.push_back(CA);
-          CB_stack.push_back(CB);
-          GA_stack.push_back(GA);
-          GB_stack.push_back(GB);
-          GR_stack.push_back(GR);
-          LR_stack.push_back(LR);
-          LA_stack.push_back(LA);
-          LB_stack.push_back(LB);
-          iLA_stack.push_back(iLA);
-          iLB_stack.push_back(iLB);
+          frame_t & F = frames[++top];
+          F.UA = UA; F.UB = UB; F.UR = UR;
+          F.DA = DA; F.DB = DB; F.DR = DR;
+          F.CA = CA; F.CB = CB;
+          F.GA = GA; F.GB = GB; F.GR = GR;
+          F.LR = LR; F.LA = LA; F.LB = LB; F.iLA = iLA; F.iLB = iLB;
 
           x = OPs<N>.lsb_idx(UA);
           y = OPs<N>.lsb_idx(GA);
@@ -4053,10 +3994,9 @@ struct Peigen::function_t
 
         LA[x] = y; iLA[y] = x;
         PRINT(cout << "Guess: LA[" << x + '\0'  << "] = " << y + '\0'  << endl);
-        GS_stack.push_back(y);
+        frames[top].GS = y;
 
-        PRINT(cout << "GS_stack.size(): " << GS_stack.size() << " at line: " << __LINE__ << endl);
-        PRINT(cout << "UA_stack.size(): " << UA_stack.size() << " at line: " << __LINE__ << endl);
+        PRINT(cout << "top: " << top << " at line: " << __LINE__ << endl);
 
         Set_t DA_tmp = DA;
         Set_t GA_old = GA;
@@ -4319,18 +4259,99 @@ struct Peigen::function_t
           min_LR = LR;
           min_LA = LA;
           min_LB = LB;
+          found = true;
         
           last_rejected = true;
         }
       }
     }
 
-    memcpy(RS, min_LR.data(), sizeof(uint8_t) * LUT_UNIT_N);
-    memcpy(A, min_LA.data(), sizeof(uint8_t) * LUT_UNIT_N);
-    memcpy(B, min_LB.data(), sizeof(uint8_t) * LUT_UNIT_N);
+    if (found)
+    {
+      memcpy(RS, min_LR.data(), sizeof(uint8_t) * LUT_UNIT_N);
+      memcpy(A, min_LA.data(), sizeof(uint8_t) * LUT_UNIT_N);
+      memcpy(B, min_LB.data(), sizeof(uint8_t) * LUT_UNIT_N);
+    }
+    return found;
+  }
+
+  // The canonical representative of the affine equivalence class,
+  // RS(x) = B^-1(S(A(x) + a) + b) with A and B linear (as RS = B^-1 o S o A
+  // for LE_representative()), with b = S(a) so that RS(0) = 0.
+  // The points a are keyed by the sorted DDT[x][S(a) + S(a + x)], x != 0,
+  // which is the key of A(a) + c in B(S(A(x) + c)) + d; only the a of the
+  // smallest group of equal keys (then of the smallest key) are tried, and
+  // RS is the smallest LE representative of their S(x + a) + S(a), each
+  // search bounded by the smallest RS so far; the first a giving it is kept.
+  void AE_representative(uint8_t RS[LUT_UNIT_N], uint8_t A[LUT_UNIT_N], uint8_t B[LUT_UNIT_N], uint8_t & a, uint8_t & b) const
+  {
+    if (!is_permutation())
+    {
+      return;
+    }
+
+    uint8_t * S = (uint8_t *) LUT;
+    vector<int> DDT(1 << (2*N), 0);
+    for (int x = 1; x < (1<<N); x++)
+    {
+      for (int y = 0; y < (1<<N); y++)
+      {
+        DDT[(x << N) | (S[y] ^ S[y ^ x])]++;
+      }
+    }
+    map<vector<int>, vector<int> > groups;
+    for (int ai = 0; ai < (1<<N); ai++)
+    {
+      vector<int> key((1<<N) - 1);
+      for (int x = 1; x < (1<<N); x++)
+      {
+        key[x - 1] = DDT[(x << N) | (S[ai] ^ S[ai ^ x])];
+      }
+      std::sort(key.begin(), key.end());
+      groups[key].push_back(ai);
+    }
+    const vector<int> * min_group = &(groups.begin()->second);
+    for (const auto & group : groups)
+    {
+      if (group.second.size() < min_group->size()) min_group = &group.second;
+    }
+
+    array<uint8_t, LUT_UNIT_N> R;
+    array<uint8_t, LUT_UNIT_N> LA;
+    array<uint8_t, LUT_UNIT_N> LB;
+    array<uint8_t, LUT_UNIT_N> min_R;
+    min_R.fill(numeric_limits<uint8_t>::max());
+
+    function_t SaF;
+    for (int ai : *min_group)
+    {
+      OPs<N>.composite(SaF.LUT, LUT, XE<N>()[ai].LUT);
+      OPs<N>.composite(SaF.LUT, XE<N>()[S[ai]].LUT, SaF.LUT);
+      if (SaF.LE_representative_search(R.data(), LA.data(), LB.data(), min_R.data()) && (R < min_R))
+      {
+        min_R = R;
+        memcpy(A, LA.data(), sizeof(uint8_t) * LUT_UNIT_N);
+        memcpy(B, LB.data(), sizeof(uint8_t) * LUT_UNIT_N);
+        a = ai;
+        b = S[ai];
+      }
+    }
+    memcpy(RS, min_R.data(), sizeof(uint8_t) * LUT_UNIT_N);
+  }
+
+  void AE_representative(function_t & RS, function_t & A, function_t & B, uint8_t & a, uint8_t & b) const
+  {
+    if (!is_permutation())
+    {
+      return;
+    }
+    AE_representative((uint8_t *)RS.LUT, (uint8_t *)A.LUT, (uint8_t *)B.LUT, a, b);
+    RS.LUT_to_bit_slice();
+    A.LUT_to_bit_slice();
+    B.LUT_to_bit_slice();
   }
 
-  bool is_AE(const uint8_t S2[LUT_UNIT_N], uint8_t RS[LUT_UNIT_N], 
+  bool is_AE(const uint8_t S2[LUT_UNIT_N], uint8_t RS[LUT_UNIT_N],
             uint8_t S1_L1[LUT_UNIT_N], uint8_t S1_L2[LUT_UNIT_N], uint8_t &a,
             uint8_t S2_L1[LUT_UNIT_N], uint8_t S2_L2[LUT_UNIT_N], uint8_t &b) const
   {
@@ -4367,14 +4388,14 @@ struct Peigen::function_t
       LExinfo_t LExinfo;
       LExinfo.c = ai;
       
-      OPs<N>.composite(S1aF.LUT, LUT, XE<N>[ai].LUT);
+      OPs<N>.composite(S1aF.LUT, LUT, XE<N>()[ai].LUT);
       PRINT(cout << S1aF.LUT_to_string() << endl);
       S1aF.LE_representative(Rp, LExinfo.L1.data(), LExinfo.L2.data());
       PRINT(cout << __LINE__ << endl);
       PRINT(PRINT_LUT(R));
       S1_minRs.insert(pair<array<uint8_t, LUT_UNIT_N>, LExinfo_t>(R, LExinfo));
 
-      OPs<N>.composite(S2bF.LUT, XE<N>[ai].LUT, S2F.LUT);
+      OPs<N>.composite(S2bF.LUT, XE<N>()[ai].LUT, S2F.LUT);
       PRINT(cout << S2bF.LUT_to_string() << endl);
       S2bF.LE_representative(Rp, LExinfo.L1.data(), LExinfo.L2.data());
       PRINT(cout << __LINE__ << endl);
@@ -4442,7 +4463,7 @@ struct Peigen::function_t
         LExinfoGx_t<N> LExinfo;
         LExinfo.c = ai;
 
-        OPs<N>.composite(SbF.LUT, XE<N>[ai].LUT, LUT);
+        OPs<N>.composite(SbF.LUT, XE<N>()[ai].LUT, LUT);
         SbF.LE_representative(Rp, LExinfo.L1.data(), LExinfo.L2.data());
         S_Rs.insert(pair<array<uint8_t, LUT_UNIT_N>, LExinfoGx_t<N> >(R, LExinfo));
       }
@@ -4454,8 +4475,8 @@ struct Peigen::function_t
 
       for (const auto & each_S_R : S_Rs)
       {
-        auto the_G_R = G_Rs<N>.find(each_S_R.first);
-        if (the_G_R != G_Rs<N>.end())
+        auto the_G_R = G_Rs<N>().find(each_S_R.first);
+        if (the_G_R != G_Rs<N>().end())
         {
           gi = (*the_G_R).second.Gx;
           Gi.LUT[0] = _mm_load_si128((__m128i *)G4[gi]); Gi.LUT_to_bit_slice();
@@ -4480,37 +4501,54 @@ struct Peigen::function_t
     }
     else
     {
-      // cout << "is_optimal(...):: Not support for N != 4" << endl;
-      return false;
+      // Gi is the representative of the class gi in AE_classes<N>()
+      if (AE_classes<N>().reps.empty() || !is_permutation())
+      {
+        return false;
+      }
+
+      function_t RF;
+      function_t LA;
+      function_t LB;
+      uint8_t c;
+      uint8_t d;
+      AE_representative(RF, LA, LB, c, d);
+      array<uint8_t, LUT_UNIT_N> R;
+      memcpy(R.data(), (uint8_t *)RF.LUT, sizeof(uint8_t) * LUT_UNIT_N);
+      gi = AE_classes<N>().find(R);
+      if (gi == -1)
+      {
+        return false;
+      }
+
+      // RF(x) = LB^-1(S(LA(x) + c) + d)
+      Gi = RF;
+      A = LA.inverse();
+      B = LB;
+      a = ((uint8_t *)A.LUT)[c];
+      b = d;
+      return true;
     }
   }
 
     // B(Gi(A(x) + a)) + b = S(x)
   bool is_optimal(int & gi, uint8_t Gi[LUT_UNIT_N], uint8_t A[LUT_UNIT_N], uint8_t B[LUT_UNIT_N], uint8_t & a, uint8_t & b) const
   {
-    if (N == 4)
+    if (!is_permutation())
     {
-      if (!is_permutation())
-      {
-        return false;
-      }
-      function_t G_F;
-      function_t A_F;
-      function_t B_F;
-      bool flag = is_optimal(gi, G_F, A_F, B_F, a, b);
-      if (flag)
-      {
-        memcpy(Gi, (uint8_t *)G_F.LUT, sizeof(uint8_t)*LUT_UNIT_N);
-        memcpy(A, (uint8_t *)A_F.LUT, sizeof(uint8_t)*LUT_UNIT_N);
-        memcpy(B, (uint8_t *)B_F.LUT, sizeof(uint8_t)*LUT_UNIT_N);
-      }
-      return flag;
+      return false;
     }
-    else
+    function_t G_F;
+    function_t A_F;
+    function_t B_F;
+    bool flag = is_optimal(gi, G_F, A_F, B_F, a, b);
+    if (flag)
     {
-      // cout << "is_optimal(...):: Not support for N != 4" << endl;
-      return false;
+      memcpy(Gi, (uint8_t *)G_F.LUT, sizeof(uint8_t)*LUT_UNIT_N);
+      memcpy(A, (uint8_t *)A_F.LUT, sizeof(uint8_t)*LUT_UNIT_N);
+      memcpy(B, (uint8_t *)B_F.LUT, sizeof(uint8_t)*LUT_UNIT_N);
     }
+    return flag;
   }
 
   void get_AE_PEreps(set<function_t > & PEreps) const
@@ -4611,15 +4649,15 @@ struct Peigen::function_t
         LExinfoGx_t<N> LExinfo;
         LExinfo.c = ai;
 
-        OPs<N>.composite(SbF.LUT, XE<N>[ai].LUT, LUT);
+        OPs<N>.composite(SbF.LUT, XE<N>()[ai].LUT, LUT);
         SbF.LE_representative(Rp, LExinfo.L1.data(), LExinfo.L2.data());
         S_Rs.insert(pair<array<uint8_t, LUT_UNIT_N>, LExinfoGx_t<N> >(R, LExinfo));
       }
 
       for (const auto & each_S_R : S_Rs)
       {
-        auto the_G_R = G_Rs<N>.find(each_S_R.first);
-        if (the_G_R != G_Rs<N>.end())
+        auto the_G_R = G_Rs<N>().find(each_S_R.first);
+        if (the_G_R != G_Rs<N>().end())
         {
           return (*the_G_R).second.Gx;
         }
@@ -4628,8 +4666,19 @@ struct Peigen::function_t
     }
     else
     {
-      //cout << "which_optimal():: Not support for N != 4" << endl;
-      return -1;
+      // the class in AE_classes<N>(), -1 when there is none to look in
+      if (AE_classes<N>().reps.empty() || !is_permutation())
+      {
+        return -1;
+      }
+
+      array<uint8_t, LUT_UNIT_N> R;
+      array<uint8_t, LUT_UNIT_N> LA;
+      array<uint8_t, LUT_UNIT_N> LB;
+      uint8_t c;
+      uint8_t d;
+      AE_representative(R.data(), LA.data(), LB.data(), c, d);
+      return AE_classes<N>().find(R);
     }
   }
 
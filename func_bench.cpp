@@ -0,0 +1,300 @@
+/**
+ * PEIGEN: a Platform for Evaluation, Implementation, and Generation of S-boxes
+ *
+ *  Copyright 2019 by
+ *    Zhenzhen Bao <baozhenzhen10[at]gmail.com>
+ *    Jian Guo <guojian[at]ntu.edu.sg>
+ *    San Ling <lingsan[at]ntu.edu.sg>
+ *    Yu Sasaki <yu[dot]sasaki[dot]sk@hco.ntt.co.jp>
+ * 
+ * This platform is developed based on the open source application
+ * <http://jeremy.jean.free.fr/pub/fse2018_layer_implementations.tar.gz>
+ * Optimizing Implementations of Lightweight Building Blocks
+ *
+ *  Copyright 2017 by
+ *    Jade Tourteaux <Jade[dot]Tourteaux[at]gmail.com>
+ *    Jérémy Jean <Jean[dot]Jeremy[at]gmail.com>
+ * 
+ * We follow the same copyright policy.
+ * 
+ * This file is part of some open source application.
+ * 
+ * Some open source application is free software: you can redistribute 
+ * it and/or modify it under the terms of the GNU General Public 
+ * License as published by the Free Software Foundation, either 
+ * version 3 of the License, or (at your option) any later version.
+ * 
+ * Some open source application is distributed in the hope that it will 
+ * be useful, but WITHOUT ANY WARRANTY; without even the implied warranty 
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Foobar.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @license GPL-3.0+ <http://spdx.org/licenses/GPL-3.0+>
+ */
+
+// Benchmarks of the DDT and LAT computations on random permutations:
+//  - the full LAT, built twice by make benchfunc, with the fast Walsh-Hadamard
+//    transform and with -DNFWHT (the previous code); only this part runs with NFWHT,
+//  - the full DDT with difference_row() against the scalar rows,
+//  - the threshold tests used when filtering and generating S-boxes,
+//    difference_distribution_matrix_test() and linear_approximation_matrix_test(),
+//    against computing the full DDT and LAT.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include <random>
+#include <chrono>
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wsign-compare"
+#pragma GCC diagnostic ignored "-Wmisleading-indentation"
+
+#include "func.hpp"
+
+#pragma GCC diagnostic pop
+
+using namespace Peigen;
+using namespace std;
+
+// nb random permutations of N bits, the same for every run
+template<int N>
+vector<function_t<N> > random_permutations(int nb)
+{
+  mt19937 gen(N);
+  vector<function_t<N> > funcs;
+  for (int k = 0; k < nb; k++)
+  {
+    uint8_t LUT[LUT_XMM_N * 16] = {0};
+    for (int x = 0; x < LUT_UNIT_N; x++) LUT[x] = x;
+    shuffle(LUT, LUT + LUT_UNIT_N, gen);
+    funcs.push_back(function_t<N>(LUT));
+  }
+  return funcs;
+}
+
+// the best of 3 runs of loop(), in us per function
+template<class F>
+double time_us(int nb, F loop)
+{
+  double best = 0;
+  for (int r = 0; r < 3; r++)
+  {
+    auto t0 = chrono::steady_clock::now();
+    loop();
+    double t = chrono::duration<double, micro>(chrono::steady_clock::now() - t0).count() / nb;
+    if ((r == 0) || (t < best)) best = t;
+  }
+  return best;
+}
+
+// Full LAT; the sum of Lin over the permutations is the same with and without NFWHT
+template<int N>
+void bench_LAT(int nb)
+{
+  static int LAT[LUT_UNIT_N][LUT_UNIT_N];
+  int spectrum[LUT_UNIT_N+1];
+  int spectrum1[LUT_UNIT_N+1];
+  int Lin, Lin1;
+  long Lin_sum = 0;
+  vector<function_t<N> > funcs = random_permutations<N>(nb);
+
+  double full = time_us(nb, [&]()
+  {
+    Lin_sum = 0;
+    for (auto & f : funcs)
+    {
+      f.linear_approximation_matrix(LAT, Lin, spectrum, Lin1, spectrum1);
+      Lin_sum += Lin;
+    }
+  });
+  printf("  N = %d : %10.2f us (sum of Lin %ld)\n", N, full, Lin_sum);
+}
+
+// The full DDT as difference_distribution_matrix() computed it for N >= 5
+// before difference_row(), one scalar S[x] ^ S[x ^ id] at a time
+template<int N>
+void scalar_difference_distribution_matrix(const function_t<N> & f, int DDT[LUT_UNIT_N][LUT_UNIT_N], int & Diff, int DDT_spectrum[LUT_UNIT_N+1], int & Diff1, int DDT1_spectrum[LUT_UNIT_N+1])
+{
+  memset(DDT[0], 0, sizeof(int) * LUT_UNIT_N * LUT_UNIT_N);
+  Diff = 0;
+  memset(DDT_spectrum, 0, sizeof(int) * (LUT_UNIT_N+1));
+  Diff1 = 0;
+  memset(DDT1_spectrum, 0, sizeof(int) * (LUT_UNIT_N+1));
+
+  const uint8_t * S = (const uint8_t *)f.LUT;
+  int cnt;
+  for (int i = 1; i <= N; i++)
+  {
+    int id = HWorder<N>[i];
+    for (int x = 0; x < LUT_UNIT_N; x++)
+    {
+      int od = S[x] ^ S[x ^ id];
+      DDT[id][od]++;
+    }
+    for (int o = 1; o <= N; o++)
+    {
+      int od = HWorder<N>[o];
+      cnt = DDT[id][od];
+      Diff = cnt > Diff ? cnt : Diff;
+      DDT_spectrum[cnt]++;
+      Diff1 = cnt > Diff1 ? cnt : Diff1;
+      DDT1_spectrum[cnt]++;
+    }
+    for (int o = N + 1; o <= LUT_UNIT_N; o++)
+    {
+      int od = HWorder<N>[o%LUT_UNIT_N];
+      cnt = DDT[id][od];
+      DDT_spectrum[cnt]++;
+      Diff = cnt > Diff ? cnt : Diff;
+    }
+  }
+  for (int i = N + 1; i < LUT_UNIT_N; i++)
+  {
+    int id = HWorder<N>[i];
+    for (int x = 0; x < LUT_UNIT_N; x++)
+    {
+      int od = S[x] ^ S[x ^ id];
+      DDT[id][od]++;
+    }
+    for (int od = 0; od < LUT_UNIT_N; od++)
+    {
+      cnt = DDT[id][od];
+      DDT_spectrum[cnt]++;
+      Diff = cnt > Diff ? cnt : Diff;
+    }
+  }
+  DDT[0][0] = LUT_UNIT_N;
+  DDT_spectrum[LUT_UNIT_N]++;
+  DDT_spectrum[0] += LUT_UNIT_N - 1;
+}
+
+// Full DDT, scalar rows against difference_row()
+template<int N>
+void bench_DDT(int nb)
+{
+  static int DDT[LUT_UNIT_N][LUT_UNIT_N];
+  static int DDT_s[LUT_UNIT_N][LUT_UNIT_N];
+  int spectrum[LUT_UNIT_N+1], spectrum_s[LUT_UNIT_N+1];
+  int spectrum1[LUT_UNIT_N+1], spectrum1_s[LUT_UNIT_N+1];
+  int Diff, Diff_s, Diff1, Diff1_s;
+  vector<function_t<N> > funcs = random_permutations<N>(nb);
+
+  bool same = true;
+  for (auto & f : funcs)
+  {
+    f.difference_distribution_matrix(DDT, Diff, spectrum, Diff1, spectrum1);
+    scalar_difference_distribution_matrix(f, DDT_s, Diff_s, spectrum_s, Diff1_s, spectrum1_s);
+    same = same && (memcmp(DDT, DDT_s, sizeof(DDT)) == 0) && (Diff == Diff_s) && (Diff1 == Diff1_s) &&
+           (memcmp(spectrum, spectrum_s, sizeof(spectrum)) == 0) && (memcmp(spectrum1, spectrum1_s, sizeof(spectrum1)) == 0);
+  }
+  double scalar = time_us(nb, [&]()
+  {
+    for (auto & f : funcs) scalar_difference_distribution_matrix(f, DDT_s, Diff_s, spectrum_s, Diff1_s, spectrum1_s);
+  });
+  double row = time_us(nb, [&]()
+  {
+    for (auto & f : funcs) f.difference_distribution_matrix(DDT, Diff, spectrum, Diff1, spectrum1);
+  });
+  printf("  N = %d : scalar rows %9.2f us, difference_row %9.2f us, speedup %4.2fx%s\n",
+         N, scalar, row, scalar / row, same ? "" : " MISMATCH");
+}
+
+// -1 leaves a bound unchecked, as in the tests
+template<int N>
+void bench(int nb, int MaxDiff_Bound, int MaxLin_Bound, int DiffFreq_Bound, int LinFreq_Bound)
+{
+  static int DDT[LUT_UNIT_N][LUT_UNIT_N];
+  static int LAT[LUT_UNIT_N][LUT_UNIT_N];
+  int spectrum[LUT_UNIT_N+1];
+  int spectrum1[LUT_UNIT_N+1];
+  int Diff, Diff1, Lin, Lin1;
+  vector<function_t<N> > funcs = random_permutations<N>(nb);
+
+  // the number of functions within the bounds, from the full tables and from the tests
+  long Diff_good = 0, Diff_pass = 0;
+  long Lin_good = 0, Lin_pass = 0;
+  double full_DDT = time_us(nb, [&]()
+  {
+    Diff_good = 0;
+    for (auto & f : funcs)
+    {
+      f.difference_distribution_matrix(DDT, Diff, spectrum, Diff1, spectrum1);
+      Diff_good += ((MaxDiff_Bound == -1) || (Diff <= MaxDiff_Bound)) && ((DiffFreq_Bound == -1) || (spectrum[Diff] <= DiffFreq_Bound));
+    }
+  });
+  double test_DDT = time_us(nb, [&]()
+  {
+    Diff_pass = 0;
+    for (auto & f : funcs) Diff_pass += f.difference_distribution_matrix_test(MaxDiff_Bound, -1, DiffFreq_Bound, -1);
+  });
+  double full_LAT = time_us(nb, [&]()
+  {
+    Lin_good = 0;
+    for (auto & f : funcs)
+    {
+      f.linear_approximation_matrix(LAT, Lin, spectrum, Lin1, spectrum1);
+      Lin_good += ((MaxLin_Bound == -1) || (Lin <= MaxLin_Bound)) && ((LinFreq_Bound == -1) || (spectrum[Lin] <= LinFreq_Bound));
+    }
+  });
+  double test_LAT = time_us(nb, [&]()
+  {
+    Lin_pass = 0;
+    for (auto & f : funcs) Lin_pass += f.linear_approximation_matrix_test(MaxLin_Bound, -1, LinFreq_Bound, -1);
+  });
+
+  printf("N = %d, %d random permutations\n", N, nb);
+  printf("  Diff <= %3d, DiffFreq <= %3d : full DDT %9.2f us, test %8.2f us, work saved %5.1f%%%s\n",
+         MaxDiff_Bound, DiffFreq_Bound, full_DDT, test_DDT, 100.0 * (1.0 - test_DDT / full_DDT), (Diff_good != Diff_pass) ? " MISMATCH" : "");
+  printf("  Lin  <= %3d, LinFreq  <= %3d : full LAT %9.2f us, test %8.2f us, work saved %5.1f%%%s\n",
+         MaxLin_Bound, LinFreq_Bound, full_LAT, test_LAT, 100.0 * (1.0 - test_LAT / full_LAT), (Lin_good != Lin_pass) ? " MISMATCH" : "");
+}
+
+int main()
+{
+  #ifndef NFWHT
+  printf("Full LAT of %s random permutations, fast Walsh-Hadamard transform\n", "10000/10000/5000/1000/200/20");
+  #else
+  printf("Full LAT of %s random permutations, NFWHT\n", "10000/10000/5000/1000/200/20");
+  #endif
+  bench_LAT<3>(10000);
+  bench_LAT<4>(10000);
+  bench_LAT<5>(5000);
+  bench_LAT<6>(1000);
+  bench_LAT<7>(200);
+  bench_LAT<8>(20);
+
+  #ifndef NFWHT
+  printf("Full DDT of %s random permutations\n", "20000/5000/1000/200");
+  bench_DDT<5>(20000);
+  bench_DDT<6>(5000);
+  bench_DDT<7>(1000);
+  bench_DDT<8>(200);
+
+  printf("Threshold tests against the full tables\n");
+  // bounds of the best known S-boxes, most permutations are rejected early
+  bench<5>(20000, 2, 8, -1, -1);
+  bench<6>(5000, 4, 16, -1, -1);
+  bench<7>(1000, 2, 16, -1, -1);
+  bench<8>(200, 4, 32, -1, -1);
+  // loose bounds, met by some of the permutations
+  bench<5>(20000, 8, 20, -1, -1);
+  bench<6>(5000, 10, 32, -1, -1);
+  bench<7>(1000, 10, 48, -1, -1);
+  bench<8>(200, 12, 72, -1, -1);
+  // trivial bounds, every entry is checked
+  bench<5>(20000, 32, 32, -1, -1);
+  bench<6>(5000, 64, 64, -1, -1);
+  bench<7>(1000, 128, 128, -1, -1);
+  bench<8>(200, 256, 256, -1, -1);
+  // frequency bounds only
+  bench<5>(20000, -1, -1, 20, 20);
+  bench<6>(5000, -1, -1, 20, 20);
+  bench<7>(1000, -1, -1, 20, 20);
+  bench<8>(200, -1, -1, 20, 20);
+  #endif
+  return 0;
+}
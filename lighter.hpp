@@ -40,6 +40,7 @@
 
 #include "func.hpp"
 #include "evaluator.hpp"
+#include "lighter_graphe.hpp"
 
 #define NOT1                  1
 #define XOR2                  2
@@ -270,8 +271,8 @@ public:
     function_t<N> unsorted_arrival;
     function_t<N> unsorted_function;
     int PEo[N];
-    map<int, set<function_t<N>> > f1_succ;
-    map<int, set<function_t<N>> > f2_succ;
+    graphe_t<N> f1_succ;
+    graphe_t<N> f2_succ;
 
     int count_list;
     int shortest_path = numeric_limits<int>::max();
@@ -308,8 +309,33 @@ public:
     int gate_and3  = false;
     int gate_andn2  = false;
     int gate_orn2   = false;
+
+    int batch_mode = false;
+    int batch_size = 64;
+
+    // checkpoint/resume of generate()
+    int resume_mode = false;
+    int resume_phase = 0;
+    int resume_c1 = 0;
+    size_t resume_layer_n = 0;
+    vector<uint32_t> resume_todo;
+    set<string> emitted_sboxes;
+    int ckpt_phase = 0;
+    int ckpt_c1 = 0;
+    size_t ckpt_layer_n = 0;
+    vector<uint32_t> ckpt_todo; // positions in the layer ckpt_c1 to be checked
+    vector<uint8_t> ckpt_done;
+    time_t ckpt_time = 0;
+
+    // sharding of generate() over processes, shard_i in [0, shard_k)
+    int shard_i = 0;
+    int shard_k = 1;
+    int merge_k = 0;
+    string out_dir = ""; // prefix of the outputs of generate()
+
+    string classes_file = ""; // affine equivalence classes, see classify()
    
-    struct option longopts[16] = {
+    struct option longopts[21] = {
       { "not1", no_argument, &gate_not1, 1},
       { "and2", no_argument, &gate_and2, 1},
       { "nand2", no_argument, &gate_nand2, 1},
@@ -325,6 +351,11 @@ public:
       { "or3", no_argument, &gate_or3, 1},
       { "andn2", no_argument, &gate_andn2, 1},
       { "orn2", no_argument, &gate_orn2, 1},
+      { "batch", no_argument, &batch_mode, 1},
+      { "resume", no_argument, &resume_mode, 1},
+      { "shard", required_argument, NULL, 'S'},
+      { "merge", required_argument, NULL, 'M'},
+      { "classify", required_argument, NULL, 'K'},
       {0, 0, 0, 0}
     };
     
@@ -359,6 +390,23 @@ public:
     int MaxDegFreq_Criteria = -1;
     int MinDegFreq_Criteria = -1;
 
+    // The criteria compiled by init_critiera() into a pipeline of independent
+    // predicates, see is_good(); each thread keeps its own order and counters.
+    enum { CRIT_INVOLUTION, CRIT_DDT_ROW, CRIT_DDT, CRIT_LAT, CRIT_DEGREE, CRIT_NB };
+    struct crit_stats_t
+    {
+      int order[CRIT_NB];
+      int nb = 0;
+      uint64_t total = 0;
+      uint64_t calls[CRIT_NB] = {0};
+      uint64_t rejects[CRIT_NB] = {0};
+      uint64_t cycles[CRIT_NB] = {0};
+      uint64_t samples[CRIT_NB] = {0};
+      char pad[64]; // no false sharing between the threads
+    };
+    vector<int> crit_stages;
+    mutable vector<crit_stats_t> crit_stats;
+
     // void parse_args(string args);
 
     void reset()
@@ -404,6 +452,29 @@ public:
       gate_andn2  = false;
       gate_orn2   = false;
 
+      batch_mode = false;
+      batch_size = 64;
+
+      resume_mode = false;
+      resume_phase = 0;
+      resume_c1 = 0;
+      resume_layer_n = 0;
+      resume_todo.clear();
+      emitted_sboxes.clear();
+      ckpt_phase = 0;
+      ckpt_c1 = 0;
+      ckpt_layer_n = 0;
+      ckpt_todo.clear();
+      ckpt_done.clear();
+      ckpt_time = 0;
+
+      shard_i = 0;
+      shard_k = 1;
+      merge_k = 0;
+      out_dir = "";
+
+      classes_file = "";
+
       Cost_Criteria = -1;
       Involution_Criteria = -1;
       Diff_Criteria = -1;
@@ -418,6 +489,8 @@ public:
       MinDeg_Criteria = -1;
       MaxDegFreq_Criteria = -1;
       MinDegFreq_Criteria = -1;
+      crit_stages.clear();
+      crit_stats.clear();
     }
 
     void init_varbles()
@@ -469,15 +542,15 @@ public:
 
     int get_semi_impl(function_t<N> f,
                     int count_vlist,
-                    map<int, set<function_t<N> > > *g,
+                    graphe_t<N> *g,
                     string *s,
                     bool reverse);
 
     void get_implementation(function_t<N> f1,
                       function_t<N> f2,
                       int v,
-                      map<int, set<function_t<N> > > *g1,
-                      map<int, set<function_t<N> > > *g2);
+                      graphe_t<N> *g1,
+                      graphe_t<N> *g2);
 
     //void get_implementation_concatenate(function_t<N> f1, int v1, function_t<N> f2, int v2, function_t<N> f3);
 
@@ -491,7 +564,7 @@ public:
 
     void exit_m();
 
-    void graphe_to_file(map<int, set<function_t<N> > > *graphe,
+    void graphe_to_file(graphe_t<N> *graphe,
                     string graphe_name);
 
     void print_uint16(uint16_t n);
@@ -504,20 +577,20 @@ public:
 
     void mitm(function_t<N> f1, function_t<N> f2);
 
-    void expand(map<int, set<function_t<N> > > *current,
-            map<int, set<function_t<N> > > *opposite,
+    void expand(graphe_t<N> *current,
+            graphe_t<N> *opposite,
             int lambda);
 
     void v_list_process(int lambda, int op_cost, vector<function_t<N> > *tmp,
-                    map<int, set<function_t<N> > > *current,
-                    set<function_t<N> > *to_insert, map<int,set<function_t<N> > > *opposite);
+                    graphe_t<N> *current,
+                    vector<node_t<N> > *to_insert, graphe_t<N> *opposite);
 
-    bool is_in_graphe(int lambda, int op_cost, function_t<N> f, map<int, set<function_t<N> > > *g);
+    bool is_in_graphe(int lambda, int op_cost, function_t<N> f, graphe_t<N> *g);
    
     bool is_in_graphe_collision(int lambda, int op_cost, function_t<N> f,
                             function_t<N> *fun_found,
                             int *vect_found,
-                            map<int, set<function_t<N> > > *g);
+                            graphe_t<N> *g);
 
     void pre_compute(string args);
     void pre_computing();
@@ -531,17 +604,28 @@ public:
     void concatenate(function_t<N> f1, function_t<N> f2);
     void expand(int lambda);
     void v_list_process(int lambda, int op_cost, vector<function_t<N> > *tmp,
-                    set<function_t<N> > *to_insert);
+                    vector<node_t<N> > *to_insert);
     bool is_in_graphe(int lambda, int op_cost, function_t<N> f);
     void match(int cost1);
     //void check_dup();
  
     void init_critiera(string conf_file);
+    void print_criteria_stats();
     void generate(string args);
     void generate();
     void filter(int c1);
     void filter_pre(int c1);
 
+    string checkpoint_filename();
+    void write_checkpoint();
+    bool read_checkpoint();
+    bool checkpoint_skip(int phase, int c1);
+    void checkpoint_layer(int phase, int c1, size_t n);
+    void checkpoint_done(size_t k);
+
+    string shard_dir(int i, int k);
+    void merge_shards(string args);
+
     int get_semi_impl_good(function_t<N> f, int count_vlist, string *s);
 
     int get_semi_impl_good(function_t<N> f,
@@ -559,12 +643,31 @@ public:
 
     void evaluate(string sboxesfile, string outputfile);
 
+    void evaluate(string args);
+
     void evaluate_verbose(string sboxesfile, string outputfile_prefix);
 
+    void classify(string sboxesfile, string classesfile, string outputfile);
+
     void evaluate_filter(string args);
    
-    // require LUT and bit_slice forms are all computed
-    bool is_good(function_t<N> & func) const
+    // a partial DDT row scan: row 1 aborts at the first count over the bound on
+    // every entry, max(Diff, Diff1); a necessary condition of the full DDT test
+    bool is_good_DDT_row(const function_t<N> & func) const
+    {
+      int bound = Diff_Criteria;
+      if (Diff1_Criteria > bound) bound = Diff1_Criteria;
+      uint8_t cnt[LUT_UNIT_N] = {0};
+      const uint8_t * S = (const uint8_t *)func.LUT;
+      for (int x = 0; x < LUT_UNIT_N; x++)
+      {
+        if (++cnt[S[x] ^ S[x ^ 1]] > bound) return false;
+      }
+      return true;
+    }
+
+    // stage s of the criteria pipeline
+    bool is_good_stage(int s, const function_t<N> & func) const
     {
       int max_degree;
       int min_degree;
@@ -572,46 +675,140 @@ public:
       int max_degree_freq;
       int min_degree_freq;
 
-      if (Involution_Criteria != -1)
-      {
-        if (func.is_involution() != Involution_Criteria) return false;
-      }
-
-      if ((Diff_Criteria != -1) || (Diff1_Criteria != -1) || (DiffFreq_Criteria != -1) || (CardD1_Criteria != -1))
+      switch (s)
       {
-        if (!func.difference_distribution_matrix_test(Diff_Criteria, Diff1_Criteria, DiffFreq_Criteria, CardD1_Criteria)) return false;
+        case CRIT_INVOLUTION:
+          return func.is_involution() == Involution_Criteria;
+        case CRIT_DDT_ROW:
+          return is_good_DDT_row(func);
+        case CRIT_DDT:
+          return func.difference_distribution_matrix_test(Diff_Criteria, Diff1_Criteria, DiffFreq_Criteria, CardD1_Criteria);
+        case CRIT_LAT:
+          return func.linear_approximation_matrix_test(Lin_Criteria, Lin1_Criteria, LinFreq_Criteria, CardL1_Criteria);
+        case CRIT_DEGREE:
+          func.degree(deg_spectrum, max_degree, min_degree);
+          max_degree_freq = deg_spectrum[max_degree];
+          min_degree_freq = deg_spectrum[min_degree];
+          if ((MinDeg_Criteria != -1) && (min_degree < MinDeg_Criteria)) return false;
+          if ((MinDegFreq_Criteria != -1) && (min_degree_freq > MinDegFreq_Criteria)) return false;
+          if ((MaxDeg_Criteria != -1) && (max_degree < MaxDeg_Criteria)) return false;
+          if ((MaxDegFreq_Criteria != -1) && (max_degree_freq < MaxDegFreq_Criteria)) return false;
+          return true;
       }
+      return true;
+    }
 
-      if ((Lin_Criteria != -1) || (Lin1_Criteria != -1) || (LinFreq_Criteria != -1) || (CardL1_Criteria != -1))
+    // Reorder the stages by expected cost per rejection, cycles / rejection rate,
+    // i.e. cheap and selective predicates first.
+    void crit_adapt(crit_stats_t & st) const
+    {
+      double rank[CRIT_NB];
+      for (int i = 0; i < st.nb; i++)
       {
-        if (!func.linear_approximation_matrix_test(Lin_Criteria, Lin1_Criteria, LinFreq_Criteria, CardL1_Criteria)) return false;
+        int s = st.order[i];
+        double cost = (st.samples[s] == 0) ? 1.0 : ((double)st.cycles[s] / st.samples[s]);
+        double rate = (st.rejects[s] + 1.0) / (st.calls[s] + 2.0);
+        rank[s] = cost / rate;
       }
+      stable_sort(st.order, st.order + st.nb, [&rank](int a, int b) { return rank[a] < rank[b]; });
+    }
 
-      if ((MaxDegFreq_Criteria != -1) || (MinDegFreq_Criteria != -1) || (MaxDeg_Criteria != -1) || (MinDeg_Criteria != -1))
+    // require LUT and bit_slice forms are all computed;
+    // kept out of line, inlined it slows down the inner loop of filter()
+    NOINLINE_ bool is_good(function_t<N> & func) const
+    {
+      if (crit_stats.empty()) // not compiled, all stages in the default order
       {
-        func.degree(deg_spectrum, max_degree, min_degree);
-        max_degree_freq = deg_spectrum[max_degree];
-        min_degree_freq = deg_spectrum[min_degree];
-        if (MinDeg_Criteria != -1)
+        if ((Involution_Criteria != -1) && !is_good_stage(CRIT_INVOLUTION, func)) return false;
+        if ((Diff_Criteria != -1) || (Diff1_Criteria != -1) || (DiffFreq_Criteria != -1) || (CardD1_Criteria != -1))
         {
-          if (min_degree < MinDeg_Criteria) return false;
+          if (!is_good_stage(CRIT_DDT, func)) return false;
         }
-        if (MinDegFreq_Criteria != -1)
+        if ((Lin_Criteria != -1) || (Lin1_Criteria != -1) || (LinFreq_Criteria != -1) || (CardL1_Criteria != -1))
         {
-          if (min_degree_freq > MinDegFreq_Criteria) return false;
+          if (!is_good_stage(CRIT_LAT, func)) return false;
         }
-        if (MaxDeg_Criteria != -1)
+        if ((MaxDegFreq_Criteria != -1) || (MinDegFreq_Criteria != -1) || (MaxDeg_Criteria != -1) || (MinDeg_Criteria != -1))
         {
-          if (max_degree < MaxDeg_Criteria) return false;
+          if (!is_good_stage(CRIT_DEGREE, func)) return false;
         }
-        if (MaxDegFreq_Criteria != -1)
+        return true;
+      }
+
+      // the stages are independent predicates, their order does not change the result
+      crit_stats_t & st = crit_stats[omp_get_thread_num() % crit_stats.size()];
+      bool sample = ((st.total & 63) == 0);
+      st.total++;
+      for (int i = 0; i < st.nb; i++)
+      {
+        int s = st.order[i];
+        st.calls[s]++;
+        uint64_t t0 = sample ? __rdtsc() : 0;
+        bool good = is_good_stage(s, func);
+        if (sample)
         {
-          if (max_degree_freq < MaxDegFreq_Criteria) return false;      
+          st.cycles[s] += __rdtsc() - t0;
+          st.samples[s]++;
+        }
+        if (!good)
+        {
+          st.rejects[s]++;
+          if ((st.total & 4095) == 0) crit_adapt(st);
+          return false;
         }
       }
+      if ((st.total & 4095) == 0) crit_adapt(st);
       return true;
     }
 
+    // Bit i is cleared if func2 o func_perms[i] fails the bound on the DDT entries,
+    // i.e. is not good; perm_LUTs holds the LUTs of func_perms two by two.
+    // For N = 3, 4, the FACT_(N) compositions and their DDT rows are computed
+    // two per __m256i, from the LUTs only; for N > 4 all bits are set.
+    uint32_t is_good_perms(const function_t<N> & func2, const __m256i perm_LUTs[]) const
+    {
+      uint32_t res = 0xffffffff;
+      if ((N > 4) || (Diff_Criteria == -1)) return res;
+
+      // a bound on every DDT entry checked by difference_distribution_matrix_test()
+      int bound = Diff_Criteria;
+      if (Diff1_Criteria > bound) bound = Diff1_Criteria;
+
+      const __m256i S2 = _mm256_broadcastsi128_si256(func2.LUT[0]);
+      const __m256i xx = _mm256_broadcastsi128_si256(x);
+      // for N = 3, the bytes above LUT_UNIT_N are set to distinct values out of the range
+      alignas(32) uint8_t pad_bytes[32];
+      for (int j = 0; j < 32; j++) pad_bytes[j] = ((j & 0xf) < LUT_UNIT_N) ? 0 : (0x10 | j);
+      const __m256i pad = _mm256_load_si256((const __m256i *)pad_bytes);
+      const __m256i keep = _mm256_cmpeq_epi8(pad, _mm256_setzero_si256());
+      for (int i = 0; i < FACT_(N) / 2; i++)
+      {
+        __m256i S = _mm256_shuffle_epi8(S2, perm_LUTs[i]);
+        int fail = 0; // bit 0 and 1 for the two compositions
+        // row id of the DDT: the multiplicity of each byte of t, counted by
+        // comparing t with its rotations, is bounded iff every entry is
+        for (int id = 1; (id < LUT_UNIT_N) && (fail != 3); id++)
+        {
+          __m256i t = _mm256_shuffle_epi8(S, _mm256_xor_si256(xx, _mm256_set1_epi8(id)));
+          t = _mm256_or_si256(_mm256_and_si256(_mm256_xor_si256(S, t), keep), pad);
+          __m256i cnt = _mm256_setzero_si256();
+          #undef RotCnt
+          #define RotCnt(r) cnt = _mm256_sub_epi8(cnt, _mm256_cmpeq_epi8(t, _mm256_alignr_epi8(t, t, r)));
+          RotCnt(1);  RotCnt(2);  RotCnt(3);  RotCnt(4);  RotCnt(5);
+          RotCnt(6);  RotCnt(7);  RotCnt(8);  RotCnt(9);  RotCnt(10);
+          RotCnt(11); RotCnt(12); RotCnt(13); RotCnt(14); RotCnt(15);
+          #undef RotCnt
+          // cnt + 1 > bound for a byte of the LUT
+          uint32_t m = _mm256_movemask_epi8(_mm256_cmpgt_epi8(cnt, _mm256_set1_epi8(bound - 1)));
+          if (m & 0xffff) fail |= 1;
+          if (m >> 16) fail |= 2;
+        }
+        if (fail & 1) res &= ~(1U << (2 * i));
+        if (fail & 2) res &= ~(1U << (2 * i + 1));
+      }
+      return res;
+    }
+
     void evaluate(string name, const function_t<N> & f, int Cost, string CostisBest, ofstream & outf)
     {
       evaluator<N> Eva(f, name, Cost, CostisBest);
@@ -628,6 +825,8 @@ public:
 #include "lighter_mitm.hpp"
 #include "lighter_utils.hpp"
 #include "lighter_impl_info.hpp"
+#include "lighter_checkpoint.hpp"
+#include "lighter_shard.hpp"
 
 #undef NOT1                  
 #undef XOR2                  
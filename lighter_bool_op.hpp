@@ -850,6 +850,23 @@ void lighter<N>::init_critiera(string criteria_file)
       }
     }
   }
+
+  // Compile the criteria into the stages of is_good(), in the order of their
+  // estimated cost; is_good() then adapts it to the observed rejection rates.
+  crit_stages.clear();
+  if (Involution_Criteria != -1) crit_stages.push_back(CRIT_INVOLUTION);
+  if (Diff_Criteria != -1) crit_stages.push_back(CRIT_DDT_ROW);
+  if ((Diff_Criteria != -1) || (Diff1_Criteria != -1) || (DiffFreq_Criteria != -1) || (CardD1_Criteria != -1))
+    crit_stages.push_back(CRIT_DDT);
+  if ((Lin_Criteria != -1) || (Lin1_Criteria != -1) || (LinFreq_Criteria != -1) || (CardL1_Criteria != -1))
+    crit_stages.push_back(CRIT_LAT);
+  if ((MaxDegFreq_Criteria != -1) || (MinDegFreq_Criteria != -1) || (MaxDeg_Criteria != -1) || (MinDeg_Criteria != -1))
+    crit_stages.push_back(CRIT_DEGREE);
+
+  crit_stats_t st;
+  st.nb = crit_stages.size();
+  for (int i = 0; i < st.nb; i++) st.order[i] = crit_stages[i];
+  crit_stats.assign(max(omp_nb_threads, 1), st);
 }
 
 template<int N>
@@ -0,0 +1,254 @@
+/**
+ * PEIGEN: a Platform for Evaluation, Implementation, and Generation of S-boxes
+ *
+ *  Copyright 2019 by
+ *    Zhenzhen Bao <baozhenzhen10[at]gmail.com>
+ *    Jian Guo <guojian[at]ntu.edu.sg>
+ *    San Ling <lingsan[at]ntu.edu.sg>
+ *    Yu Sasaki <yu[dot]sasaki[dot]sk@hco.ntt.co.jp>
+ * 
+ * This platform is developed based on the open source application
+ * <http://jeremy.jean.free.fr/pub/fse2018_layer_implementations.tar.gz>
+ * Optimizing Implementations of Lightweight Building Blocks
+ *
+ *  Copyright 2017 by
+ *    Jade Tourteaux <Jade[dot]Tourteaux[at]gmail.com>
+ *    Jérémy Jean <Jean[dot]Jeremy[at]gmail.com>
+ * 
+ * We follow the same copyright policy.
+ * 
+ * This file is part of some open source application.
+ * 
+ * Some open source application is free software: you can redistribute 
+ * it and/or modify it under the terms of the GNU General Public 
+ * License as published by the Free Software Foundation, either 
+ * version 3 of the License, or (at your option) any later version.
+ * 
+ * Some open source application is distributed in the hope that it will 
+ * be useful, but WITHOUT ANY WARRANTY; without even the implied warranty 
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Foobar.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @license GPL-3.0+ <http://spdx.org/licenses/GPL-3.0+>
+ */
+
+#ifndef LIGHTER_CHECKPOINT_H__
+#define LIGHTER_CHECKPOINT_H__
+
+#include "func.hpp"
+
+using namespace Peigen;
+using namespace Peigen::weight;
+using namespace std;
+
+/*
+  Checkpoints of generate().
+  generate() checks the layers c1 with filter_pre() in increasing c1, then with
+  filter() in decreasing c1. Every LIGHTER_CHECKPOINT_PERIOD seconds, the phase,
+  the layer c1 and the positions of this layer which remain to be checked are
+  written to <out_dir><imp_info>__checkpoint.txt, together with Cost_Criteria, good_number
+  and good_PE_number.
+  With --resume, the layers checked before the checkpoint are skipped and only
+  the remaining positions of the layer of the checkpoint are checked.
+  The last checkpoint of a completed run has the phase 3, nothing is left to check.
+  The S-boxes already written in the statistics files are not written again.
+*/
+#ifndef LIGHTER_CHECKPOINT_PERIOD
+#define LIGHTER_CHECKPOINT_PERIOD 600
+#endif
+
+#define LIGHTER_CHECKPOINT_VERSION 1
+
+template<int N>
+string lighter<N>::checkpoint_filename()
+{
+  return out_dir + imp_info + "__checkpoint.txt";
+}
+
+template<int N>
+void lighter<N>::write_checkpoint()
+{
+  string fn = checkpoint_filename();
+  string tmp_fn = fn + ".tmp";
+  ofstream fout(tmp_fn);
+  fout << "version " << LIGHTER_CHECKPOINT_VERSION << endl;
+  fout << "imp_info " << imp_info << endl;
+  fout << "criteria_file " << criteria_file << endl;
+  fout << "pre_l " << pre_l << endl;
+  fout << "l " << l << endl;
+  fout << "shard " << shard_i << "/" << shard_k << endl;
+  fout << "threads " << omp_nb_threads << endl;
+  fout << "phase " << ckpt_phase << endl;
+  fout << "count_list " << ckpt_c1 << endl;
+  fout << "layer_size " << ckpt_layer_n << endl;
+  fout << "Cost_Criteria " << Cost_Criteria << endl;
+  fout << "good_number " << good_number << endl;
+  fout << "good_PE_number " << good_PE_number << endl;
+
+  // the remaining positions, as ranges [begin, end) of consecutive positions
+  size_t k = 0;
+  while (k < ckpt_todo.size())
+  {
+    uint8_t done;
+    #pragma omp atomic read
+    done = ckpt_done[k];
+    if (done)
+    {
+      k++;
+      continue;
+    }
+    uint32_t begin = ckpt_todo[k];
+    uint32_t end = begin + 1;
+    k++;
+    while (k < ckpt_todo.size())
+    {
+      #pragma omp atomic read
+      done = ckpt_done[k];
+      if (done || (ckpt_todo[k] != end)) break;
+      end++;
+      k++;
+    }
+    fout << "range " << begin << " " << end << endl;
+  }
+  fout.close();
+
+  if (!fout) cout << "Error: failed to write " << tmp_fn << endl;
+  else rename(tmp_fn.c_str(), fn.c_str());
+}
+
+template<int N>
+bool lighter<N>::read_checkpoint()
+{
+  ifstream fin(checkpoint_filename());
+  if (!fin)
+  {
+    cout << "No checkpoint " << checkpoint_filename() << ", starting from the beginning" << endl;
+    return false;
+  }
+
+  map<string, string> values;
+  vector<uint32_t> todo;
+  for (string line; getline(fin, line); )
+  {
+    istringstream is_line(line);
+    string key;
+    is_line >> key;
+    if (key == "range")
+    {
+      uint32_t begin, end;
+      is_line >> begin >> end;
+      for (uint32_t i = begin; i < end; i++) todo.push_back(i);
+    }
+    else
+    {
+      getline(is_line >> ws, values[key]);
+    }
+  }
+  fin.close();
+
+  if ((atoi(values["version"].c_str()) != LIGHTER_CHECKPOINT_VERSION) ||
+      (values["imp_info"] != imp_info) ||
+      (values["criteria_file"] != criteria_file) ||
+      (atoi(values["pre_l"].c_str()) != pre_l) ||
+      (atoi(values["l"].c_str()) != l) ||
+      (values["shard"] != to_string(shard_i) + "/" + to_string(shard_k)))
+  {
+    cout << "Error: " << checkpoint_filename() << " does not match the parameters" << endl;
+    return false;
+  }
+
+  resume_phase = atoi(values["phase"].c_str());
+  resume_c1 = atoi(values["count_list"].c_str());
+  resume_layer_n = strtoul(values["layer_size"].c_str(), NULL, 10);
+  resume_todo.swap(todo);
+  Cost_Criteria = atoi(values["Cost_Criteria"].c_str());
+  good_number = atoi(values["good_number"].c_str());
+  good_PE_number = atoi(values["good_PE_number"].c_str());
+
+  // S-boxes may have been written after the checkpoint
+  int threads = max(omp_nb_threads, atoi(values["threads"].c_str()));
+  for (int tid = 0; tid < threads; tid++)
+  {
+    ifstream inf(out_dir + imp_info + "__" + "statistics_Part" + to_string(tid) + ".csv");
+    for (string line; getline(inf, line); )
+    {
+      istringstream is_line(line);
+      string name, sbox;
+      getline(is_line, name, ',');
+      getline(is_line, sbox, ',');
+      getline(is_line, sbox, ',');
+      if (name == "Cipher") continue;
+      emitted_sboxes.insert(sbox);
+      good_number = max(good_number, atoi(name.c_str()) + 1);
+    }
+  }
+  ifstream PEsboxf(out_dir + imp_info + "_PEsboxes.txt");
+  int PE_lines = 0;
+  for (string line; getline(PEsboxf, line); ) PE_lines++;
+  good_PE_number = max(good_PE_number, PE_lines);
+
+  cout << "Resume from " << checkpoint_filename() << " : phase " << resume_phase
+       << ", layer " << resume_c1 << ", " << resume_todo.size() << " / " << resume_layer_n
+       << " remaining" << endl;
+  return true;
+}
+
+template<int N>
+bool lighter<N>::checkpoint_skip(int phase, int c1)
+{
+  // The layers checked before the checkpoint
+  if (resume_phase == 0) return false;
+  if (phase != resume_phase) return phase < resume_phase;
+  return (phase == 1) ? (c1 < resume_c1) : (c1 > resume_c1);
+}
+
+template<int N>
+void lighter<N>::checkpoint_layer(int phase, int c1, size_t n)
+{
+  ckpt_phase = phase;
+  ckpt_c1 = c1;
+  ckpt_layer_n = n;
+  bool resumed = false;
+  if ((resume_phase == phase) && (resume_c1 == c1))
+  {
+    if (resume_layer_n == n)
+    {
+      ckpt_todo.swap(resume_todo);
+      resumed = true;
+    }
+    else
+    {
+      cout << "Error: the layer " << c1 << " does not match the checkpoint, it is checked from the beginning" << endl;
+    }
+    resume_phase = 0;
+    resume_todo.clear();
+  }
+  if (!resumed)
+  {
+    // the positions of the shard shard_i
+    ckpt_todo.clear();
+    for (size_t i = shard_i; i < n; i += shard_k) ckpt_todo.push_back(i);
+  }
+  ckpt_done.assign(ckpt_todo.size(), 0);
+  if (ckpt_time == 0) ckpt_time = time(NULL);
+}
+
+template<int N>
+void lighter<N>::checkpoint_done(size_t k)
+{
+  #pragma omp atomic write
+  ckpt_done[k] = 1;
+
+  if ((omp_get_thread_num() == 0) && (time(NULL) >= ckpt_time + LIGHTER_CHECKPOINT_PERIOD))
+  {
+    // Cost_Criteria and good_number are updated in the unnamed critical section
+    #pragma omp critical
+    write_checkpoint();
+    ckpt_time = time(NULL);
+  }
+}
+
+#endif // LIGHTER_CHECKPOINT_H__
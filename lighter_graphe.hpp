@@ -0,0 +1,580 @@
+/**
+ * PEIGEN: a Platform for Evaluation, Implementation, and Generation of S-boxes
+ *
+ *  Copyright 2019 by
+ *    Zhenzhen Bao <baozhenzhen10[at]gmail.com>
+ *    Jian Guo <guojian[at]ntu.edu.sg>
+ *    San Ling <lingsan[at]ntu.edu.sg>
+ *    Yu Sasaki <yu[dot]sasaki[dot]sk@hco.ntt.co.jp>
+ * 
+ * This platform is developed based on the open source application
+ * <http://jeremy.jean.free.fr/pub/fse2018_layer_implementations.tar.gz>
+ * Optimizing Implementations of Lightweight Building Blocks
+ *
+ *  Copyright 2017 by
+ *    Jade Tourteaux <Jade[dot]Tourteaux[at]gmail.com>
+ *    Jérémy Jean <Jean[dot]Jeremy[at]gmail.com>
+ * 
+ * We follow the same copyright policy.
+ * 
+ * This file is part of some open source application.
+ * 
+ * Some open source application is free software: you can redistribute 
+ * it and/or modify it under the terms of the GNU General Public 
+ * License as published by the Free Software Foundation, either 
+ * version 3 of the License, or (at your option) any later version.
+ * 
+ * Some open source application is distributed in the hope that it will 
+ * be useful, but WITHOUT ANY WARRANTY; without even the implied warranty 
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Foobar.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @license GPL-3.0+ <http://spdx.org/licenses/GPL-3.0+>
+ */
+
+#ifndef LIGHTER_GRAPHE_H__
+#define LIGHTER_GRAPHE_H__
+
+#include "func.hpp"
+
+using namespace Peigen;
+using namespace Peigen::weight;
+using namespace std;
+
+#define GRAPHE_TABLE_INIT_N (1 << 10)
+#define GRAPHE_BLOCK_BITS 16
+#define GRAPHE_BLOCK_N (1 << GRAPHE_BLOCK_BITS)
+
+/*
+  Layout of a pre_*.bin file (one file per cost layer):
+    pre_bin_header_t
+    count node_t records sorted by bit slice, at records_offset
+    an open-addressing table of table_size uint32_t (record index + 1, 0 for empty), at table_offset
+  Both offsets are multiples of PRE_BIN_ALIGN, the file is mapped read-only and searched in place.
+  The records of version 1 are complete function_t.
+*/
+#define PRE_BIN_MAGIC "PEIGENPB"
+#define PRE_BIN_VERSION 2
+#define PRE_BIN_ALIGN 64
+
+struct pre_bin_header_t
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t n;
+  uint32_t record_size;
+  int32_t cost;
+  uint64_t count;
+  uint64_t records_offset;
+  uint64_t table_offset;
+  uint64_t table_size;
+};
+
+/*
+  A node of the graph, as stored in memory and in the pre_*.bin files:
+  the sorted bit slice and the back-pointer to the previous node
+  (the previous line, the index of the changed line and the operation).
+  The LUT is not stored, it is recomputed when the node is materialized as a function_t.
+*/
+template<int N>
+struct Peigen::weight::node_t
+{
+  bit_slice_t<N> bit_slice;
+  bit_slice_l_t<N> prev;
+  uint8_t info_line;
+  uint8_t info_op;
+
+  node_t() {};
+
+  node_t(const function_t<N> & f) : bit_slice(f.bit_slice), prev(f.prev), info_line(f.info_line), info_op(f.info_op) {};
+
+  function_t<N> function() const
+  {
+    function_t<N> f;
+    f.bit_slice = bit_slice;
+    f.prev = prev;
+    f.info_line = info_line;
+    f.info_op = info_op;
+    f.bit_slice_to_LUT();
+    return f;
+  }
+
+  bool operator < (const node_t & n) const
+  {
+    return bit_slice < n.bit_slice;
+  }
+};
+
+/*
+  The cost-layered graph of the search.
+  Every node is stored once as a node_t, together with its cost, in blocks of GRAPHE_BLOCK_N
+  entries (the nodes never move, so references to them stay valid);
+  an open-addressing table (linear probing) over the sorted bit slices
+  maps a function to its node, so that membership and best-cost queries
+  are a single probe.
+  The layers keep the indices of their nodes sorted by bit slice.
+  When a node is re-inserted with a smaller cost, its old index becomes
+  stale in the old layer and is dropped on the next merge into that layer.
+
+  Layers read from pre_*.bin files are mapped (map_layer) instead of copied
+  as long as no node is in memory yet, they take the indices [0, mapped_n)
+  and the nodes in memory come after.
+  A mapped node re-inserted with a smaller cost is shadowed by a node in memory.
+*/
+template<int N>
+class Peigen::weight::graphe_t
+{
+public:
+    struct layer_t
+    {
+      vector<uint32_t> idx;
+      size_t size = 0;
+      uint32_t mapped_base = 0;
+      uint32_t mapped_n = 0;
+    };
+
+    map<int, layer_t> layers;
+
+    graphe_t() { clear(); };
+
+    graphe_t(const graphe_t &) = delete;
+
+    graphe_t & operator = (const graphe_t &) = delete;
+
+    ~graphe_t() { unmap(); };
+
+    void clear()
+    {
+      unmap();
+      nodes.clear();
+      costs.clear();
+      nodes_n = 0;
+      layers.clear();
+      table.assign(GRAPHE_TABLE_INIT_N, 0);
+      mask = GRAPHE_TABLE_INIT_N - 1;
+    }
+
+    size_t size() const
+    {
+      return mapped_n + nodes_n;
+    }
+
+    // memory taken by one node: its record, its cost, its index in a layer
+    // and at least two slots of the table (the load factor stays below 1/2)
+    static constexpr size_t bytes_per_node()
+    {
+      return sizeof(node_t<N>) + sizeof(int) + sizeof(uint32_t) + 2 * sizeof(uint32_t);
+    }
+
+    // index of the node of f (a function_t or a node_t), -1 if f is not in the graph
+    template<class T>
+    long find(const T & f) const
+    {
+      size_t h = hash(f);
+      long i = find_in_memory(f, h);
+      if ((i < 0) && (mapped_n != 0))
+      {
+        for (auto & m : mapped)
+        {
+          size_t pos = h & m.mask;
+          while (m.table[pos] != 0)
+          {
+            uint32_t r = m.table[pos] - 1;
+            if (m.recs[r].bit_slice == f.bit_slice) return m.base + r;
+            pos = (pos + 1) & m.mask;
+          }
+        }
+      }
+      return i;
+    }
+
+    // cost of f, -1 if f is not in the graph
+    template<class T>
+    int cost(const T & f) const
+    {
+      long i = find(f);
+      return i < 0 ? -1 : node_cost(i);
+    }
+
+    // the node i materialized as a function_t
+    function_t<N> node(long i) const
+    {
+      return compact_node(i).function();
+    }
+
+    const node_t<N> & compact_node(long i) const
+    {
+      if (i < mapped_n)
+      {
+        const mapped_t & m = mapped_of(i);
+        return m.recs[i - m.base];
+      }
+      i -= mapped_n;
+      return nodes[i >> GRAPHE_BLOCK_BITS][i & (GRAPHE_BLOCK_N - 1)];
+    }
+
+    int node_cost(long i) const
+    {
+      if (i < mapped_n) return mapped_of(i).c;
+      i -= mapped_n;
+      return costs[i >> GRAPHE_BLOCK_BITS][i & (GRAPHE_BLOCK_N - 1)];
+    }
+
+    // indices of the nodes of cost c, sorted by bit slice
+    vector<uint32_t> layer(int c) const
+    {
+      vector<uint32_t> res;
+      auto it = layers.find(c);
+      if (it != layers.end())
+      {
+        const layer_t & ly = it->second;
+        res.reserve(ly.size);
+        if (ly.mapped_n == 0)
+        {
+          for (auto i : ly.idx)
+          {
+            if (node_cost(i) == c) res.push_back(i);
+          }
+        }
+        else
+        {
+          auto cmp = [this](uint32_t a, uint32_t b) { return compact_node(a) < compact_node(b); };
+          uint32_t i_mapped = ly.mapped_base;
+          uint32_t i_mapped_end = ly.mapped_base + ly.mapped_n;
+          auto it_mem = ly.idx.begin();
+          while ((i_mapped != i_mapped_end) || (it_mem != ly.idx.end()))
+          {
+            if ((it_mem != ly.idx.end()) && (node_cost(*it_mem) != c))
+            {
+              it_mem++;
+            }
+            else if ((i_mapped != i_mapped_end) && (shadowed_n != 0) && (find_in_memory(compact_node(i_mapped), hash(compact_node(i_mapped))) >= 0))
+            {
+              i_mapped++;
+            }
+            else if ((it_mem == ly.idx.end()) || ((i_mapped != i_mapped_end) && cmp(i_mapped, *it_mem)))
+            {
+              res.push_back(i_mapped++);
+            }
+            else
+            {
+              res.push_back(*it_mem++);
+            }
+          }
+        }
+      }
+      return res;
+    }
+
+    void insert(int c, const function_t<N> & f)
+    {
+      insert(c, &f, &f + 1);
+    }
+
+    // Insert the functions (or nodes) of [first, last) with cost c; the layer c is created even if the range is empty.
+    // A function already in the graph is moved to layer c only if c is smaller than its cost.
+    template<class It>
+    void insert(int c, It first, It last)
+    {
+      vector<uint32_t> new_idx;
+      for (auto it = first; it != last; it++)
+      {
+        long i = find(*it);
+        if (i < 0)
+        {
+          i = push_back(*it, c);
+          table_insert(i);
+        }
+        else if (c < node_cost(i))
+        {
+          layers[node_cost(i)].size--;
+          if (i < mapped_n)
+          {
+            i = push_back(*it, c);
+            table_insert(i);
+            shadowed_n++;
+          }
+          else
+          {
+            mutable_node(i) = node_t<N>(*it);
+            mutable_node_cost(i) = c;
+          }
+        }
+        else
+        {
+          continue;
+        }
+        new_idx.push_back(i);
+      }
+
+      auto cmp = [this](uint32_t a, uint32_t b) { return compact_node(a) < compact_node(b); };
+      if (!is_sorted(new_idx.begin(), new_idx.end(), cmp)) sort(new_idx.begin(), new_idx.end(), cmp);
+
+      layer_t & ly = layers[c];
+      vector<uint32_t> merged;
+      merged.reserve(ly.idx.size() + new_idx.size());
+      auto it_old = ly.idx.begin();
+      auto it_new = new_idx.begin();
+      while ((it_old != ly.idx.end()) || (it_new != new_idx.end()))
+      {
+        if ((it_old != ly.idx.end()) && (node_cost(*it_old) != c))
+        {
+          it_old++;
+        }
+        else if ((it_new == new_idx.end()) || ((it_old != ly.idx.end()) && cmp(*it_old, *it_new)))
+        {
+          merged.push_back(*it_old++);
+        }
+        else
+        {
+          merged.push_back(*it_new++);
+        }
+      }
+      ly.idx.swap(merged);
+      ly.size += new_idx.size();
+    }
+
+    // Write the layer c to the file fn in the pre_*.bin format,
+    // through a temporary file so that a mapping of fn stays valid
+    bool write_layer(int c, string fn) const
+    {
+      vector<uint32_t> idx = layer(c);
+
+      pre_bin_header_t header;
+      memset(&header, 0, sizeof(header));
+      memcpy(header.magic, PRE_BIN_MAGIC, 8);
+      header.version = PRE_BIN_VERSION;
+      header.n = N;
+      header.record_size = sizeof(node_t<N>);
+      header.cost = c;
+      header.count = idx.size();
+      header.records_offset = PRE_BIN_ALIGN;
+      header.table_offset = align(header.records_offset + header.count * header.record_size);
+      header.table_size = 2;
+      while (header.table_size < 2 * header.count) header.table_size <<= 1;
+
+      vector<uint32_t> file_table(header.table_size, 0);
+      for (uint32_t r = 0; r < idx.size(); r++)
+      {
+        size_t pos = hash(compact_node(idx[r])) & (header.table_size - 1);
+        while (file_table[pos] != 0) pos = (pos + 1) & (header.table_size - 1);
+        file_table[pos] = r + 1;
+      }
+
+      // processes sharing the files may write the same layer
+      string tmp_fn = fn + ".tmp" + to_string(getpid());
+      ofstream fout(tmp_fn, ios::binary);
+      vector<char> pad(PRE_BIN_ALIGN, 0);
+      fout.write((char *)&header, sizeof(header));
+      fout.write(pad.data(), header.records_offset - sizeof(header));
+      for (auto i : idx)
+      {
+        fout.write((char *)&(compact_node(i)), header.record_size);
+      }
+      fout.write(pad.data(), header.table_offset - (header.records_offset + header.count * header.record_size));
+      fout.write((char *)file_table.data(), header.table_size * sizeof(uint32_t));
+      fout.close();
+      if (!fout)
+      {
+        cout << "Error: failed to write " << tmp_fn << endl;
+        return false;
+      }
+      return rename(tmp_fn.c_str(), fn.c_str()) == 0;
+    }
+
+    // Map the file fn as the layer c.
+    // Return 1 if mapped, 0 if fn does not exist or is not in the pre_*.bin format
+    // (e.g. raw records of an older version), -1 if it cannot be used with this graph.
+    int map_layer(int c, string fn)
+    {
+      int fd = open(fn.c_str(), O_RDONLY);
+      if (fd < 0) return 0;
+
+      struct stat st;
+      pre_bin_header_t header;
+      if ((fstat(fd, &st) != 0) || ((size_t)st.st_size < sizeof(header)) ||
+          (pread(fd, &header, sizeof(header), 0) != sizeof(header)) ||
+          (memcmp(header.magic, PRE_BIN_MAGIC, 8) != 0))
+      {
+        close(fd);
+        return 0;
+      }
+
+      // the records of version 1 are copied
+      bool v1 = (header.version == 1) && (header.record_size == sizeof(function_t<N>));
+      if (((header.version != PRE_BIN_VERSION) && !v1) || (header.n != N) ||
+          ((header.record_size != sizeof(node_t<N>)) && !v1) || (header.cost != c) ||
+          (header.table_offset + header.table_size * sizeof(uint32_t) > (uint64_t)st.st_size) ||
+          (header.records_offset + header.count * header.record_size > header.table_offset) ||
+          (layers[c].mapped_n != 0))
+      {
+        cout << "Error: " << fn << " cannot be mapped (version " << header.version << ", N = " << header.n << ")" << endl;
+        close(fd);
+        return -1;
+      }
+
+      void * addr = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+      close(fd);
+      if (addr == MAP_FAILED)
+      {
+        cout << "Error: failed to map " << fn << endl;
+        return -1;
+      }
+
+      const char * recs_addr = (const char *)addr + header.records_offset;
+      const node_t<N> * recs = (const node_t<N> *)recs_addr;
+      if (v1)
+      {
+        const function_t<N> * recs_v1 = (const function_t<N> *)recs_addr;
+        insert(c, recs_v1, recs_v1 + header.count);
+        munmap(addr, st.st_size);
+        return 1;
+      }
+      if (nodes_n != 0)
+      {
+        // the indices of the nodes in memory would move, copy the records instead
+        insert(c, recs, recs + header.count);
+        munmap(addr, st.st_size);
+        return 1;
+      }
+
+      mapped_t m;
+      m.c = c;
+      m.base = mapped_n;
+      m.n = header.count;
+      m.recs = recs;
+      m.table = (const uint32_t *)((const char *)addr + header.table_offset);
+      m.mask = header.table_size - 1;
+      m.addr = addr;
+      m.len = st.st_size;
+      mapped.push_back(m);
+
+      layer_t & ly = layers[c];
+      ly.mapped_base = mapped_n;
+      ly.mapped_n = header.count;
+      ly.size += header.count;
+      mapped_n += header.count;
+      return 1;
+    }
+
+private:
+    struct mapped_t
+    {
+      int c;
+      uint32_t base;
+      uint64_t n;
+      const node_t<N> * recs;
+      const uint32_t * table;
+      uint64_t mask;
+      void * addr;
+      size_t len;
+    };
+
+    vector<mapped_t> mapped; // in increasing base
+    uint32_t mapped_n = 0;
+    size_t shadowed_n = 0;
+
+    vector<vector<node_t<N> > > nodes;
+    vector<vector<int> > costs;
+    size_t nodes_n;
+
+    vector<uint32_t> table; // index + 1 of the node, 0 for an empty slot
+    size_t mask;
+
+    static uint64_t align(uint64_t offset)
+    {
+      return (offset + PRE_BIN_ALIGN - 1) / PRE_BIN_ALIGN * PRE_BIN_ALIGN;
+    }
+
+    void unmap()
+    {
+      for (auto & m : mapped) munmap(m.addr, m.len);
+      mapped.clear();
+      mapped_n = 0;
+      shadowed_n = 0;
+    }
+
+    const mapped_t & mapped_of(long i) const
+    {
+      auto it = upper_bound(mapped.begin(), mapped.end(), i, [](long j, const mapped_t & m) { return j < m.base; });
+      return *(it - 1);
+    }
+
+    template<class T>
+    long find_in_memory(const T & f, size_t h) const
+    {
+      size_t pos = h & mask;
+      while (table[pos] != 0)
+      {
+        uint32_t i = table[pos] - 1;
+        if (compact_node(i).bit_slice == f.bit_slice) return i;
+        pos = (pos + 1) & mask;
+      }
+      return -1;
+    }
+
+    node_t<N> & mutable_node(long i)
+    {
+      i -= mapped_n;
+      return nodes[i >> GRAPHE_BLOCK_BITS][i & (GRAPHE_BLOCK_N - 1)];
+    }
+
+    int & mutable_node_cost(long i)
+    {
+      i -= mapped_n;
+      return costs[i >> GRAPHE_BLOCK_BITS][i & (GRAPHE_BLOCK_N - 1)];
+    }
+
+    template<class T>
+    uint32_t push_back(const T & f, int c)
+    {
+      if ((nodes_n & (GRAPHE_BLOCK_N - 1)) == 0)
+      {
+        nodes.emplace_back();
+        nodes.back().reserve(GRAPHE_BLOCK_N);
+        costs.emplace_back();
+        costs.back().reserve(GRAPHE_BLOCK_N);
+      }
+      nodes.back().push_back(node_t<N>(f));
+      costs.back().push_back(c);
+      return mapped_n + nodes_n++;
+    }
+
+    template<class T>
+    static size_t hash(const T & f)
+    {
+      uint64_t h = 0;
+      for (int i = 0; i < N; i++)
+      {
+        for (int j = 0; j < UNIT_N; j++)
+        {
+          h = (h ^ (uint64_t)f.bit_slice[i][j]) * 0x9E3779B97F4A7C15ULL;
+        }
+      }
+      return h ^ (h >> 29);
+    }
+
+    void table_insert(uint32_t i)
+    {
+      // keep the load factor below 1/2
+      if (2 * nodes_n > table.size())
+      {
+        table.assign(2 * table.size(), 0);
+        mask = table.size() - 1;
+        for (uint32_t j = mapped_n; j < i; j++) table_place(j);
+      }
+      table_place(i);
+    }
+
+    void table_place(uint32_t i)
+    {
+      size_t pos = hash(compact_node(i)) & mask;
+      while (table[pos] != 0) pos = (pos + 1) & mask;
+      table[pos] = i + 1;
+    }
+};
+
+#endif // LIGHTER_GRAPHE_H__
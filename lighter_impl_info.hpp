@@ -121,12 +121,11 @@ void lighter<N>::get_string_impl(string *s, function_t<N> f, bool reverse)
 template<int N>
 int lighter<N>::get_semi_impl(function_t<N> f,
                     int count_vlist,
-                    map<int, set<function_t<N> > > *g,
+                    graphe_t<N> *g,
                     string *s,
                     bool reverse)
 {
   int cost = bool_op_cost(f.info_op);
-  auto found = g->at(0).find(f);
   unsorted_function = f;
   while(count_vlist >= 0)
   {
@@ -136,8 +135,7 @@ int lighter<N>::get_semi_impl(function_t<N> f,
     f.sort();
     count_vlist -= bool_op_cost(f.info_op);
     if( count_vlist == 0) break;
-    found = g->at(count_vlist).find(f);
-    f = *found;
+    f = g->node(g->find(f));
     cost += bool_op_cost(f.info_op);
   }
 
@@ -161,8 +159,8 @@ template<int N>
 void lighter<N>::get_implementation(function_t<N> f1,
                       function_t<N> f2,
                       int v,
-                      map<int, set<function_t<N> > > *g1,
-                      map<int, set<function_t<N> > > *g2)
+                      graphe_t<N> *g1,
+                      graphe_t<N> *g2)
 {
   static int impl_number = 0;
   if(instance_name != old_instance_name)
@@ -207,7 +205,6 @@ int lighter<N>::get_semi_impl_concatenate(function_t<N> f,
                     bool reverse, int PE[])
 {
   int cost = bool_op_cost(f.info_op);
-  auto found = f1_succ.at(0).find(f);
   unsorted_function = f;
   while(count_vlist >= 0)
   {
@@ -217,8 +214,7 @@ int lighter<N>::get_semi_impl_concatenate(function_t<N> f,
     f.sort();
     count_vlist -= bool_op_cost(f.info_op);
     if( count_vlist == 0) break;
-    found = f1_succ.at(count_vlist).find(f);
-    f = *found;
+    f = f1_succ.node(f1_succ.find(f));
     cost += bool_op_cost(f.info_op);
   }
 
@@ -285,7 +281,6 @@ int lighter<N>::get_semi_impl_good(
 {
   function_t<N> f_org = f;
   int cost = bool_op_cost(f.info_op);
-  auto found = f1_succ.at(0).find(f);
   unsorted_function = f;
   while(count_vlist >= 0)
   {
@@ -295,8 +290,7 @@ int lighter<N>::get_semi_impl_good(
     f.sort();
     count_vlist -= bool_op_cost(f.info_op);
     if( count_vlist == 0) break;
-    found = f1_succ.at(count_vlist).find(f);
-    f = *found;
+    f = f1_succ.node(f1_succ.find(f));
     cost += bool_op_cost(f.info_op);
   }
 
@@ -319,7 +313,6 @@ int lighter<N>::get_semi_impl_good(
 {
   function_t<N> f_org = f;
   int cost = bool_op_cost(f.info_op);
-  auto found = f1_succ.at(0).find(f);
   unsorted_function = f;
   while(count_vlist >= 0)
   {
@@ -329,8 +322,7 @@ int lighter<N>::get_semi_impl_good(
     f.sort();
     count_vlist -= bool_op_cost(f.info_op);
     if( count_vlist == 0) break;
-    found = f1_succ.at(count_vlist).find(f);
-    f = *found;
+    f = f1_succ.node(f1_succ.find(f));
     cost += bool_op_cost(f.info_op);
   }
 
@@ -339,7 +331,7 @@ int lighter<N>::get_semi_impl_good(
   s->insert(0, "\n" + get_permut(start, unsorted_function, 'F', 'X') + "\n");
   s->insert(0, "// from : " + start.to_string() + "\n");
   s->append("// to : " + f_org.to_string() + "\n");
-  for (int i = 0; i < N; i++) s->append("X[" + to_string(i) + "] = F[" + to_string(PE<N>.idx[pi][i]) + "];\n"); 
+  for (int i = 0; i < N; i++) s->append("X[" + to_string(i) + "] = F[" + to_string(PE<N>().idx[pi][i]) + "];\n"); 
   s->append("// perm : " + f_p.to_string() + "\n");
 
   return cost;
@@ -352,8 +344,11 @@ void lighter<N>::get_implementation_good(
                       function_t<N> f2, int v2,
                       function_t<N> f3, int good_idx)
 {
+  // written before the run was resumed
+  if (emitted_sboxes.count(f3.to_string()) != 0) return;
+
   int tid = omp_get_thread_num();
-  string outfn = imp_info + "__" + "statistics_Part" + to_string(tid) + ".csv";
+  string outfn = out_dir + imp_info + "__" + "statistics_Part" + to_string(tid) + ".csv";
   ifstream inf(outfn.c_str());
   string thisSbox = f1.to_string();
   string existSbox;
@@ -382,7 +377,7 @@ void lighter<N>::get_implementation_good(
   outf << Eva.show();
   outf.close();
 
-  string fn_prefix = Eva.hash();
+  string fn_prefix = out_dir + Eva.hash();
 
   #pragma omp critical
   {
@@ -404,7 +399,7 @@ void lighter<N>::get_implementation_good(
     if (stat(f3PErep_str.c_str(), &filestate) != 0)
     {
       good_PE_number++;
-      string PEsboxfn = imp_info + "_PEsboxes.txt";
+      string PEsboxfn = out_dir + imp_info + "_PEsboxes.txt";
       ofstream PEsboxf(PEsboxfn.c_str(), ios::app);
       PEsboxf << good_PE_number << "," << f3.LUT_to_string() << endl;
       PEsboxf.close();
@@ -433,8 +428,11 @@ template<int N>
 void lighter<N>::get_implementation_good(
                       function_t<N> f1, int v, int good_idx)
 {
+  // written before the run was resumed
+  if (emitted_sboxes.count(f1.to_string()) != 0) return;
+
   int tid = omp_get_thread_num();
-  string outfn = imp_info + "__" + "statistics_Part" + to_string(tid) + ".csv";
+  string outfn = out_dir + imp_info + "__" + "statistics_Part" + to_string(tid) + ".csv";
   ifstream inf(outfn.c_str());
   string thisSbox = f1.to_string();
   string existSbox;
@@ -462,7 +460,7 @@ void lighter<N>::get_implementation_good(
   outf << Eva.show();
   outf.close();
 
-  string fn_prefix = Eva.hash();
+  string fn_prefix = out_dir + Eva.hash();
 
   #pragma omp critical
   {
@@ -484,7 +482,7 @@ void lighter<N>::get_implementation_good(
     if (stat(f1PErep_str.c_str(), &filestate) != 0)
     {
       good_PE_number++;
-      string PEsboxfn = imp_info + "_PEsboxes.txt";
+      string PEsboxfn = out_dir + imp_info + "_PEsboxes.txt";
       ofstream PEsboxf(PEsboxfn.c_str(), ios::app);
       PEsboxf << good_PE_number << "," << f1.LUT_to_string() << endl;
       PEsboxf.close();
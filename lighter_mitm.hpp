@@ -42,7 +42,9 @@ using namespace Peigen;
 using namespace Peigen::weight;
 using namespace std;
 
-#define MAX_VEC_NODES (max_nodes>>1UL)
+// max_nodes counts the nodes of the graph, the successors are complete function_t
+// and may take at most half of the memory
+#define MAX_VEC_NODES ((max_nodes * Peigen::weight::graphe_t<N>::bytes_per_node() / sizeof(function_t<N>)) >> 1UL)
 
 #define pre_parse_args()                                      \
   int myargc = 0;                                             \
@@ -64,7 +66,7 @@ using namespace std;
 
 #define post_parse_args()                                     \
   delete [] args_str;                                         \
-  max_nodes = max_ram * 100000000UL / sizeof(function_t<N>);  \
+  max_nodes = max_ram * 100000000UL / Peigen::weight::graphe_t<N>::bytes_per_node(); \
   if (gate_maoi1 == 1) gate_xor2 = 0;                         \
   if (gate_moai1 == 1) gate_xnor2 = 0;
 
@@ -123,7 +125,7 @@ void lighter<N>::pre_computing()
   }
   else
   {
-    f1_succ.insert(pair<int, set<function_t<N> > >(0, {f1}));
+    f1_succ.insert(0, f1);
     write_pre_bin(0);
     count_list = 0;
     while (count_list <= pre_l)
@@ -139,18 +141,11 @@ void lighter<N>::pre_computing()
 template<int N>
 void lighter<N>::write_pre_bin(int lambda)
 {
-  ofstream fout;
-  size_t function_s = sizeof(function_t<N>);
-  auto map_it = f1_succ.find(lambda);
-  while (map_it != f1_succ.end())
+  auto map_it = f1_succ.layers.find(lambda);
+  while (map_it != f1_succ.layers.end())
   {
     string pre_filen = "pre_" + imp_info + "_" + to_string(map_it->first) + ".bin";
-    fout.open(pre_filen, ios::binary);
-    for (auto set_it = map_it->second.begin(); set_it != map_it->second.end(); set_it++)
-    {
-      fout.write((char *)&(*set_it), function_s);
-    }
-    fout.close();
+    f1_succ.write_layer(map_it->first, pre_filen);
     map_it++;
   }
 }
@@ -167,18 +162,21 @@ void lighter<N>::read_pre_bin(int completed)
   while (lambda <= (completed + max_GE))
   {
     string pre_filen = "pre_" + imp_info + "_" + to_string(lambda) + ".bin";
-    fin.open(pre_filen, ios::binary);
-    if (fin)
+    // pre_*.bin files without header (older versions) are read record by record
+    if (f1_succ.map_layer(lambda, pre_filen) == 0)
     {
-      set<function_t<N> > new_list;    
-      f1_succ.insert(pair<int, set<function_t<N> > >(lambda, new_list));
-      auto to_insert = &(f1_succ[lambda]);
-      while (fin.read((char*)(&f_t), function_s))
+      fin.open(pre_filen, ios::binary);
+      if (fin)
       {
-        (*to_insert).insert(f_t);
+        vector<node_t<N> > new_list;
+        while (fin.read((char*)(&f_t), function_s))
+        {
+          new_list.push_back(node_t<N>(f_t));
+        }
+        f1_succ.insert(lambda, new_list.begin(), new_list.end());
       }
+      fin.close();
     }
-    fin.close();
     lambda++;
   }
   if(verbose) print_graphe_info();
@@ -333,8 +331,8 @@ void lighter<N>::mitm(function_t<N> f1, function_t<N> f2)
   f2.sort();
   f2.bit_slice_to_LUT();
 
-  if (pre_l < 0) f1_succ.insert(pair<int, set<function_t<N> > >(0, {f1}));
-  f2_succ.insert(pair<int, set<function_t<N> > >(0, {f2}));
+  if (pre_l < 0) f1_succ.insert(0, f1);
+  f2_succ.insert(0, f2);
   start = f1;
   arrival = f2;
 
@@ -385,21 +383,21 @@ void lighter<N>::mitm(function_t<N> f1, function_t<N> f2)
 }
 
 template<int N>
-void lighter<N>::expand(map<int, set<function_t<N> > > *current,
-            map<int, set<function_t<N> > > *opposite,
+void lighter<N>::expand(graphe_t<N> *current,
+            graphe_t<N> *opposite,
             int lambda)
 {
-  auto to_expand = current->find(lambda);
-  if(to_expand != current->end())
+  if(current->layers.find(lambda) != current->layers.end())
   {
+    vector<uint32_t> to_expand = current->layer(lambda);
     for(auto bool_op : b)
     {
       int bool_op_cost = bool_op.op_cost;
       vector<function_t<N> > successors;
 
-      for(auto fun : (*to_expand).second)
+      for(auto i : to_expand)
       {
-        bool_op_fun(bool_op.op_id, fun, &successors);
+        bool_op_fun(bool_op.op_id, current->node(i), &successors);
         if (successors.size() >= MAX_VEC_NODES)
         {
           sort(successors.begin(), successors.end());
@@ -412,17 +410,9 @@ void lighter<N>::expand(map<int, set<function_t<N> > > *current,
         sort(successors.begin(), successors.end());
         successors.erase(unique(successors.begin(), successors.end()), successors.end());
         
-        auto s = current->find(lambda+bool_op.op_cost);
-        set<function_t<N> > new_list;
+        vector<node_t<N> > new_list;
         v_list_process(lambda, bool_op_cost, &successors, current, &new_list, opposite);
-        if(s != current->end())
-        {
-          s->second.insert(new_list.begin(), new_list.end());
-        }
-        else
-        {
-          current->insert(pair<int,set<function_t<N> > >(lambda+bool_op.op_cost, new_list));
-        }
+        current->insert(lambda+bool_op.op_cost, new_list.begin(), new_list.end());
       }
     }
   }
@@ -430,80 +420,71 @@ void lighter<N>::expand(map<int, set<function_t<N> > > *current,
 
 template<int N>
 void lighter<N>::v_list_process(int lambda, int op_cost, vector<function_t<N> > *tmp,
-                    map<int, set<function_t<N> > > *current,
-                    set<function_t<N> > *to_insert, map<int,set<function_t<N> > > *opposite)
+                    graphe_t<N> *current,
+                    vector<node_t<N> > *to_insert, graphe_t<N> *opposite)
 {
   function_t<N>  fun_found;
   int vect_found;
+  long cnt;
+
+  // tmp is sorted and the iterations are statically scheduled in contiguous chunks,
+  // so concatenating the per-thread buffers in thread order keeps to_insert sorted
+  vector<vector<node_t<N> > > buffers(omp_nb_threads);
 
-  #pragma omp parallel for private(fun_found, vect_found) num_threads(omp_nb_threads)
+  #pragma omp parallel for schedule(static) private(fun_found, vect_found, cnt) num_threads(omp_nb_threads)
   for(auto it_tmp = tmp->begin(); it_tmp < tmp->end(); it_tmp++)
   {
     if(!is_in_graphe(lambda, op_cost, (*it_tmp), current))
     {
-      #pragma omp critical
+      buffers[omp_get_thread_num()].push_back(*it_tmp);
+      #pragma omp atomic capture
+      cnt = ++nodes_cmp;
+      if(cnt == max_nodes)
       {
-        (*it_tmp).bit_slice_to_LUT();
-        to_insert->insert(*it_tmp);
-        nodes_cmp++;
-        if(nodes_cmp == max_nodes)
-        {
-          exit_m();
-        }
+        exit_m();
       }
       if(is_in_graphe_collision(lambda, op_cost, (*it_tmp), &fun_found, &vect_found, opposite))
       {
-        #pragma omp critical
+        #pragma omp critical(collision)
         {
           //system("notify-send 'Collision'");
+          (*it_tmp).bit_slice_to_LUT();
           get_implementation((*it_tmp), fun_found, vect_found, current, opposite);
         }
       }
     }
   }
+
+  for (auto & buffer : buffers)
+  {
+    to_insert->insert(to_insert->end(), buffer.begin(), buffer.end());
+  }
 }
 
 template<int N>
-bool lighter<N>::is_in_graphe(int lambda, int op_cost, function_t<N> f, map<int, set<function_t<N> > > *g)
+bool lighter<N>::is_in_graphe(int lambda, int op_cost, function_t<N> f, graphe_t<N> *g)
 {
-  for(auto it = g->begin(); it != g->end() ; it++)
-  {
-    if((*it).second.find(f) != (*it).second.end())
-    {
-      if((*it).first > lambda+op_cost)
-      {
-        #pragma omp critical
-        {
-          (*it).second.erase(f);
-        }
-        return false;
-      }
-      return true;
-    }
-  }
-  return false;
+  // A node found with a larger cost is replaced when f is inserted
+  int c = g->cost(f);
+  return (c != -1) && (c <= lambda+op_cost);
 }
 
 template<int N>
 bool lighter<N>::is_in_graphe_collision(int lambda, int op_cost, function_t<N> f,
                             function_t<N> *fun_found,
                             int *vect_found,
-                            map<int, set<function_t<N> > > *g)
+                            graphe_t<N> *g)
 {
-  for(auto it = g->begin(); it != g->end(); it++)
-  {
-    if (it->first >= lambda - max_GE)
-    {
-      if( lambda + (*it).first + op_cost >= shortest_path ) return false;
-      if((*it).second.find(f) != (*it).second.end())
-      {
-        *vect_found = (*it).first;
-        *fun_found = *((*it).second.find(f));
-        return true;
-      }
-    }
-  }
-  return false;
+  // The layers are scanned in increasing cost and f lies in exactly one of them,
+  // so checking the bounds on the layer of f is equivalent
+  long i = g->find(f);
+  if (i < 0) return false;
+  int c = g->node_cost(i);
+  if (c < lambda - max_GE) return false;
+  if (lambda + c + op_cost >= shortest_path) return false;
+  *vect_found = c;
+  *fun_found = g->node(i);
+  return true;
 }
 
 template<int N>
@@ -656,7 +637,7 @@ void lighter<N>::concatenate(function_t<N> f1, function_t<N> f2)
   start = f1;
   arrival = f2;
 
-  if (pre_l < 0) f1_succ.insert(pair<int, set<function_t<N> > >(0, {f1}));
+  if (pre_l < 0) f1_succ.insert(0, f1);
 
   count_list = 0;
   while (count_list <= l + max_GE)
@@ -691,17 +672,17 @@ void lighter<N>::concatenate(function_t<N> f1, function_t<N> f2)
 template<int N>
 void lighter<N>::expand(int lambda)
 {
-  auto to_expand = f1_succ.find(lambda);
-  if(to_expand != f1_succ.end())
+  if(f1_succ.layers.find(lambda) != f1_succ.layers.end())
   {
+    vector<uint32_t> to_expand = f1_succ.layer(lambda);
     for(auto bool_op : b)
     {
       int bool_op_cost = bool_op.op_cost;
       vector<function_t<N> > successors;
 
-      for(auto fun : (*to_expand).second)
+      for(auto i : to_expand)
       {
-        bool_op_fun(bool_op.op_id, fun, &successors);
+        bool_op_fun(bool_op.op_id, f1_succ.node(i), &successors);
         if (successors.size() >= MAX_VEC_NODES)
         {
           sort(successors.begin(), successors.end());
@@ -714,17 +695,9 @@ void lighter<N>::expand(int lambda)
         sort(successors.begin(), successors.end());
         successors.erase(unique(successors.begin(), successors.end()), successors.end());
         
-        auto s = f1_succ.find(lambda+bool_op.op_cost);
-        set<function_t<N> > new_list;
+        vector<node_t<N> > new_list;
         v_list_process(lambda, bool_op_cost, &successors, &new_list);
-        if(s != f1_succ.end())
-        {
-          s->second.insert(new_list.begin(), new_list.end());
-        }
-        else
-        {
-          f1_succ.insert(pair<int,set<function_t<N> > >(lambda+bool_op.op_cost, new_list));
-        }
+        f1_succ.insert(lambda+bool_op.op_cost, new_list.begin(), new_list.end());
       }
     }
   }
@@ -732,62 +705,49 @@ void lighter<N>::expand(int lambda)
 
 template<int N>
 void lighter<N>::v_list_process(int lambda, int op_cost, vector<function_t<N> > *tmp,
-                    set<function_t<N> > *to_insert)
+                    vector<node_t<N> > *to_insert)
 {
-  function_t<N>  fun_found;
-  int vect_found;
+  long cnt;
 
-  #pragma omp parallel for private(fun_found, vect_found) num_threads(omp_nb_threads)
+  // tmp is sorted and the iterations are statically scheduled in contiguous chunks,
+  // so concatenating the per-thread buffers in thread order keeps to_insert sorted
+  vector<vector<node_t<N> > > buffers(omp_nb_threads);
+
+  #pragma omp parallel for schedule(static) private(cnt) num_threads(omp_nb_threads)
   for(auto it_tmp = tmp->begin(); it_tmp < tmp->end(); it_tmp++)
   {
     if(!is_in_graphe(lambda, op_cost, (*it_tmp)))
     {
-      #pragma omp critical
+      buffers[omp_get_thread_num()].push_back(*it_tmp);
+      #pragma omp atomic capture
+      cnt = ++nodes_cmp;
+      if(cnt == max_nodes)
       {
-        (*it_tmp).bit_slice_to_LUT();
-        to_insert->insert(*it_tmp);
-        nodes_cmp++;
-        if(nodes_cmp == max_nodes)
-        {
-          exit_m();
-        }
+        exit_m();
       }
     }
   }
+
+  for (auto & buffer : buffers)
+  {
+    to_insert->insert(to_insert->end(), buffer.begin(), buffer.end());
+  }
 }
 
 template<int N>
 bool lighter<N>::is_in_graphe(int lambda, int op_cost, function_t<N> f)
 {
-  for(auto it = f1_succ.begin(); it != f1_succ.end() ; it++)
-  {
-    if((*it).second.find(f) != (*it).second.end())
-    {
-      if((*it).first > lambda+op_cost)
-      {
-        #pragma omp critical
-        {
-          (*it).second.erase(f);
-        }
-        return false;
-      }
-      return true;
-    }
-  }
-  return false;
+  // A node found with a larger cost is replaced when f is inserted
+  int c = f1_succ.cost(f);
+  return (c != -1) && (c <= lambda+op_cost);
 }
 
 template<int N>
 void lighter<N>::match(int c1)
 {
-  auto f1_it = f1_succ.find(c1);
-  if (f1_it != f1_succ.end())
+  if (f1_succ.layers.find(c1) != f1_succ.layers.end())
   {
-    vector<const function_t<N>* > tmp_vec;
-    for (auto set1_it = f1_it->second.begin(); set1_it != f1_it->second.end(); set1_it++)
-	  {
-	  	tmp_vec.push_back( &(*set1_it) );
-	  }
+    vector<uint32_t> tmp_vec = f1_succ.layer(c1);
 
     //for (auto set1_it = f1_it->second.begin(); set1_it != f1_it->second.end(); set1_it++)
     #pragma omp parallel for num_threads(omp_nb_threads)
@@ -797,7 +757,7 @@ void lighter<N>::match(int c1)
       if (2 * c1 - max_GE + 1 < shortest_path)
       {
         //auto func1 = *set1_it;
-        auto func1 = **vec1_it;
+        auto func1 = f1_succ.node(*vec1_it);
 
 		    bit_slice_t<N> cp_bit_slice = OPs<N>.composite(func1.LUT, arrival.LUT);
         function_t<N> func_comp(cp_bit_slice);
@@ -805,37 +765,24 @@ void lighter<N>::match(int c1)
         int PEm[N];
         func_comp.sort(PEm);
 
-        auto f2_it = f1_succ.begin();
-        while ((f2_it != f1_succ.end()) && (f2_it->first <= (c1 + max_GE)))
+        long i2 = f1_succ.find(func_comp);
+        if (i2 >= 0)
         {
+          int c2 = f1_succ.node_cost(i2);
           #pragma omp flush
-          if ((c1 + f2_it->first) < shortest_path)
+          if ((c2 <= (c1 + max_GE)) && (c2 > (c1 - max_GE)) && ((c1 + c2) < shortest_path))
           {
-            int c2;
-            c2 = f2_it->first;
-            if (c2 > (c1 - max_GE))
+            auto func2 = f1_succ.node(i2);
+
+            #pragma omp flush
+            #pragma omp critical
             {
-              auto vec2_it = f2_it->second.find(func_comp);
-              if (vec2_it != f2_it->second.end())
+              if (shortest_path > (c1 + c2))
               {
-                auto func2 = *vec2_it;
-
-                #pragma omp flush
-                #pragma omp critical
-                {
-                  if (shortest_path > (c1 + c2))
-                  {
-                    shortest_path = c1 + c2;
-                    get_implementation_concatenate(func2, c2, func1, c1, PEm);
-                  }
-                }
+                shortest_path = c1 + c2;
+                get_implementation_concatenate(func2, c2, func1, c1, PEm);
               }
             }
-            f2_it++;
-          }
-          else
-          {
-            break;
           }
         }
       }
@@ -847,6 +794,7 @@ template<int N>
 void lighter<N>::generate(string args)
 {  
   clock_t t1 = clock();
+  LE_cache<N>().reset_stats();
 
   pre_parse_args();
   while ((opt = getopt_long(myargc, myargv, "o:l:c:vwap:f:r:s:", longopts, NULL)) != EOF)
@@ -863,6 +811,13 @@ void lighter<N>::generate(string args)
       case 'f': conf_file = optarg; break;
       case 's': criteria_file = optarg; break;
       case 'r': max_ram = atol(optarg); break;
+      case 'S': if ((sscanf(optarg, "%d/%d", &shard_i, &shard_k) != 2) || (shard_i < 0) || (shard_i >= shard_k))
+                {
+                  cout << "Error: --shard expects i/k with 0 <= i < k" << endl;
+                  shard_i = 0; shard_k = 1;
+                }
+                else cout << "Shard : " << shard_i << "/" << shard_k << endl;
+                break;
       case '?': fprintf(stderr, "wrong cmd line");
     }
   }
@@ -870,11 +825,23 @@ void lighter<N>::generate(string args)
 
   genImpInfo();
 
+  if (shard_k > 1)
+  {
+    out_dir = shard_dir(shard_i, shard_k);
+    struct stat dirstate;
+    if ((stat(out_dir.c_str(), &dirstate) != 0) && (mkdir(out_dir.c_str(), 0777) == -1))
+    {
+      cout << "Error creating directory!"  << endl;
+    }
+  }
+
   for (int tid = 0; tid < omp_nb_threads; tid++)
   {
-    string outfn = imp_info + "__" + "statistics.csv";
+    string outfn = out_dir + imp_info + "__" + "statistics.csv";
     string outfn_sub = "_Part" + to_string(tid);
     outfn.insert(outfn.rfind('.'), outfn_sub);
+    struct stat filestate;
+    if (resume_mode && (stat(outfn.c_str(), &filestate) == 0)) continue;
     ofstream outf(outfn.c_str(), ios::app);
     evaluate_writeTitleLine(outf);
     outf.close();
@@ -889,10 +856,20 @@ void lighter<N>::generate(string args)
 
   read_pre_bin(pre_l);
 
+  if (resume_mode) read_checkpoint();
+
   start = function_t<N>::INPUT_DEFAULT();
 
   generate();
 
+  // completed, a resumed run has nothing left to check
+  ckpt_phase = 3;
+  ckpt_todo.clear();
+  ckpt_done.clear();
+  write_checkpoint();
+
+  print_criteria_stats();
+  LE_cache<N>().print_stats();
   reset();
 
   t1 = clock() - t1;
@@ -907,7 +884,7 @@ void lighter<N>::generate()
   f1.sort();
   f1.bit_slice_to_LUT();
 
-  if (pre_l < 0) f1_succ.insert(pair<int, set<function_t<N> > >(0, {f1}));
+  if (pre_l < 0) f1_succ.insert(0, f1);
 
   count_list = 0;
   while (count_list <= l + max_GE)
@@ -949,7 +926,7 @@ void lighter<N>::generate()
 
   if (pre_l < 0)
   {
-    f1_succ.insert(pair<int, set<function_t<N> > >(0, {f1}));
+    f1_succ.insert(0, f1);
   }
 
   count_list = 0;
@@ -1038,17 +1015,15 @@ void lighter<N>::generate()
 template<int N>
 void lighter<N>::filter_pre(int c1)
 {
-  auto f1_it = f1_succ.find(c1);
-  if (f1_it != f1_succ.end())
+  if (checkpoint_skip(1, c1)) return;
+
+  if (f1_succ.layers.find(c1) != f1_succ.layers.end())
   {
-    vector<const function_t<N>* > tmp_vec;
-    for (auto set1_it = f1_it->second.begin(); set1_it != f1_it->second.end(); set1_it++)
-	  {
-	  	tmp_vec.push_back( &(*set1_it) );
-	  }
+    vector<uint32_t> tmp_vec = f1_succ.layer(c1);
+    checkpoint_layer(1, c1, tmp_vec.size());
 
     #pragma omp parallel for num_threads(omp_nb_threads)
-    for (auto vec1_it = tmp_vec.begin(); vec1_it < tmp_vec.end(); vec1_it++)
+    for (size_t k = 0; k < ckpt_todo.size(); k++)
     {
       int good_idx = 0;
       int good_idx_old = -1;
@@ -1056,7 +1031,7 @@ void lighter<N>::filter_pre(int c1)
       #pragma omp flush
       if (c1 <= Cost_Criteria) // for parallel; Cost_Criteria may reduced by other threads
       {
-        auto func1 = **vec1_it;
+        auto func1 = f1_succ.node(tmp_vec[ckpt_todo[k]]);
         if (is_good(func1))
         {
           #pragma omp critical
@@ -1075,6 +1050,7 @@ void lighter<N>::filter_pre(int c1)
           }        
         }
       }
+      checkpoint_done(k);
     }
   }
 }
@@ -1104,17 +1080,23 @@ void lighter<N>::filter(int c1)
   int c2UpperBound = c1 + max_GE;
   int curCostLowerBound = c1 + c2LowerBound;
 
-  auto f1_it = f1_succ.find(c1);
-  if (f1_it != f1_succ.end())
+  if (checkpoint_skip(2, c1)) return;
+
+  if (f1_succ.layers.find(c1) != f1_succ.layers.end())
   {
-    vector<const function_t<N>* > tmp_vec;
-    for (auto set1_it = f1_it->second.begin(); set1_it != f1_it->second.end(); set1_it++)
-	  {
-	  	tmp_vec.push_back( &(*set1_it) );
-	  }
+    vector<uint32_t> tmp_vec = f1_succ.layer(c1);
+    checkpoint_layer(2, c1, tmp_vec.size());
+
+    vector<pair<int, vector<uint32_t> > > layers2;
+    auto f2_it = f1_succ.layers.lower_bound(c2LowerBound);
+    while ((f2_it != f1_succ.layers.end()) && (f2_it->first <= c2UpperBound))
+    {
+      layers2.push_back(make_pair(f2_it->first, f1_succ.layer(f2_it->first)));
+      f2_it++;
+    }
 
     #pragma omp parallel for num_threads(omp_nb_threads)
-    for (auto vec1_it = tmp_vec.begin(); vec1_it < tmp_vec.end(); vec1_it++)
+    for (size_t k = 0; k < ckpt_todo.size(); k++)
     {
       int good_idx = 0;
       int good_idx_old = -1;
@@ -1122,28 +1104,26 @@ void lighter<N>::filter(int c1)
       #pragma omp flush
       if (curCostLowerBound <= Cost_Criteria) // for parallel; Cost_Criteria may reduced by other threads
       {
-        auto func1 = **vec1_it;
+        auto func1 = f1_succ.node(tmp_vec[ckpt_todo[k]]);
         vector<function_t<N> > func_perms;
         func_perms.reserve(FACT_(N));
+        __m256i perm_LUTs[FACT_(4) / 2];
         for (int i = 0; i < FACT_(N); i++)
         {
             function_t<N> func_perm;
-            OPs<N>.composite(func_perm.LUT, PE<N>.func[i].LUT, func1.LUT);
+            OPs<N>.composite(func_perm.LUT, PE<N>().func[i].LUT, func1.LUT);
             func_perm.LUT_to_bit_slice();
             func_perms.push_back(func_perm);
         }
+        for (int i = 0; (N <= 4) && (i < FACT_(N) / 2); i++)
+        {
+            perm_LUTs[i] = _mm256_set_m128i(func_perms[2 * i + 1].LUT[0], func_perms[2 * i].LUT[0]);
+        }
 
-        auto f2_it = f1_succ.begin();
-        while ((f2_it != f1_succ.end()) && (f2_it->first <= c2UpperBound))
+        for (auto layer2_it = layers2.begin(); layer2_it != layers2.end(); layer2_it++)
         {
-          int c2 = f2_it->first;
+          int c2 = layer2_it->first;
           int curCost = c1 + c2;
-
-          if (c2 < c2LowerBound)
-          {
-            f2_it++;
-            continue;
-          }
           
           #pragma omp flush
           if (curCost > Cost_Criteria)
@@ -1151,14 +1131,16 @@ void lighter<N>::filter(int c1)
             break;
           }
 
-          auto vec2_it = f2_it->second.begin();
-          while (vec2_it != f2_it->second.end())
+          auto vec2_it = layer2_it->second.begin();
+          while (vec2_it != layer2_it->second.end())
           {
-            auto func2 = *vec2_it;
+            auto func2 = f1_succ.node(*vec2_it);
+            uint32_t perms_good = is_good_perms(func2, perm_LUTs);
 
             function_t<N> func_comp;
             for (int i = 0; i < FACT_(N); i++)
             {
+                if ((N <= 4) && (((perms_good >> i) & 1) == 0)) continue;
                 OPs<N>.composite(func_comp.LUT, func2.LUT, func_perms[i].LUT);
                 func_comp.LUT_to_bit_slice();
                 if (is_good(func_comp))
@@ -1181,11 +1163,11 @@ void lighter<N>::filter(int c1)
             }
             vec2_it++;
           }            
-          f2_it++;
         }
         func_perms.clear();
         func_perms.shrink_to_fit();
       }
+      checkpoint_done(k);
     }
   }
 }
@@ -1194,6 +1176,7 @@ template<int N>
 void lighter<N>::evaluate_filter(string args)
 {
   clock_t t1 = clock();
+  LE_cache<N>().reset_stats();
 
   function_t<N> f1 = function_t<N>::INPUT_DEFAULT();
   function_t<N> f2 = function_t<N>::INPUT_DEFAULT();
@@ -1272,6 +1255,8 @@ void lighter<N>::evaluate_filter(string args)
     }
   }
 
+  print_criteria_stats();
+  LE_cache<N>().print_stats();
   reset();
 
   t1 = clock() - t1;
@@ -1325,6 +1310,8 @@ void lighter<N>::evaluate_writeTitleLine(ofstream & outf)
 template<int N>
 void lighter<N>::evaluate(string sboxesfile, string outputfile)
 {
+  LE_cache<N>().reset_stats();
+
   ifstream sboxes(sboxesfile);
   
   vector<pair<string, string> > sboxes_vec;
@@ -1353,14 +1340,46 @@ void lighter<N>::evaluate(string sboxesfile, string outputfile)
     evaluate_writeTitleLine(outfs[tid]);
   }
 
-  #pragma omp parallel for num_threads(omp_nb_threads)
-  for (auto vec_it = sboxes_vec.begin(); vec_it < sboxes_vec.end(); vec_it++)
-  {   
-    string name_str = (*vec_it).first;
-    string LUT_str = (*vec_it).second;
-    function_t<N> f(LUT_str);
-    int tid = omp_get_thread_num();
-    evaluate(name_str, f, 0, "-", outfs[tid]);
+  if (batch_mode)
+  {
+    // The DDT, LAT, degree and permutation criteria of batch_size S-boxes are computed
+    // at once by batch_evaluator, the remaining ones per S-box by evaluator
+    int batch_number = (sboxes_vec.size() + batch_size - 1) / batch_size;
+    #pragma omp parallel for num_threads(omp_nb_threads)
+    for (int bi = 0; bi < batch_number; bi++)
+    {
+      int start = bi * batch_size;
+      int n = min(batch_size, (int)sboxes_vec.size() - start);
+      vector<function_t<N> > fs(n);
+      __m128i * LUTs = new __m128i[n * LUT_XMM_N];
+      for (int i = 0; i < n; i++)
+      {
+        fs[i].parse_function(sboxes_vec[start + i].second);
+        for (int j = 0; j < LUT_XMM_N; j++) LUTs[i * LUT_XMM_N + j] = fs[i].LUT[j];
+      }
+
+      batch_evaluator<N> batch(LUTs, n);
+      delete [] LUTs;
+
+      int tid = omp_get_thread_num();
+      for (int i = 0; i < n; i++)
+      {
+        evaluator<N> Eva(fs[i], batch, i, sboxes_vec[start + i].first, 0, "-");
+        outfs[tid] << Eva.show();
+      }
+    }
+  }
+  else
+  {
+    #pragma omp parallel for num_threads(omp_nb_threads)
+    for (auto vec_it = sboxes_vec.begin(); vec_it < sboxes_vec.end(); vec_it++)
+    {   
+      string name_str = (*vec_it).first;
+      string LUT_str = (*vec_it).second;
+      function_t<N> f(LUT_str);
+      int tid = omp_get_thread_num();
+      evaluate(name_str, f, 0, "-", outfs[tid]);
+    }
   }
 
   for (int tid = 0; tid < omp_nb_threads; tid++)
@@ -1369,6 +1388,142 @@ void lighter<N>::evaluate(string sboxesfile, string outputfile)
   }
 
   delete [] outfs;
+  LE_cache<N>().print_stats();
+}
+
+template<int N>
+void lighter<N>::evaluate(string args)
+{
+  string sboxesfile = "sboxes" + to_string(N) + ".txt";
+
+  pre_parse_args();
+  while ((opt = getopt_long(myargc, myargv, "o:b:p:", longopts, NULL)) != EOF)
+  {
+    switch(opt)
+    {
+      case 'o': sboxesfile = optarg; break;
+      case 'b': batch_size = max(1, atoi(optarg)); cout << "Batch size : "<< batch_size << endl; break;
+      case 'p': omp_nb_threads = (atoi(optarg));  cout << "Thread number : "<< omp_nb_threads<<endl;break;
+      case 'K': classes_file = optarg; break;
+      case '?': fprintf(stderr, "wrong cmd line");
+    }
+  }
+  post_parse_args();
+
+  // the output is written next to sboxesfile, the prefix goes on its base name
+  size_t slash = sboxesfile.rfind('/');
+  string dir = (slash == string::npos) ? "" : sboxesfile.substr(0, slash + 1);
+  string base = sboxesfile.substr(dir.size());
+  base = base.substr(0, base.rfind('.'));
+
+  if (classes_file != "")
+  {
+    classify(sboxesfile, classes_file, dir + "AEclasses_" + base + ".csv");
+  }
+  else
+  {
+    evaluate(sboxesfile, dir + "properties_" + base + ".csv");
+  }
+}
+
+// The affine equivalence class of each S-box of sboxesfile among the classes
+// of classesfile (see AE_classes_t); the representatives are computed in
+// parallel, then the new classes are numbered in the order of sboxesfile and
+// classesfile is rewritten with them. Each line of outputfile gives the class
+// and S(x) = B(R(A(x) + a)) + b, with R the representative of the class.
+template<int N>
+void lighter<N>::classify(string sboxesfile, string classesfile, string outputfile)
+{
+  ifstream sboxes(sboxesfile);
+  
+  vector<pair<string, string> > sboxes_vec;
+  for(string line; getline(sboxes, line); )
+  {
+    istringstream instance_line(line);
+    string name_str;
+    string LUT_str;
+    if(getline(instance_line, name_str, ','))
+    {
+      if(getline(instance_line, LUT_str))
+      {
+        sboxes_vec.push_back(pair<string, string>(name_str, LUT_str));
+      }
+    }
+  }
+  sboxes.close();
+
+  AE_classes_t<N> & classes = AE_classes<N>();
+  if (!classes.load(classesfile))
+  {
+    // classesfile is left as it is, rewriting it would drop the classes after the bad line
+    cout << "Error: " << classesfile << " is not a valid file of classes, nothing classified" << endl;
+    return;
+  }
+  int known_n = classes.reps.size();
+
+  struct AEinfo_t
+  {
+    function_t<N> f;
+    function_t<N> R;
+    function_t<N> LA;
+    function_t<N> LB;
+    uint8_t c;
+    uint8_t d;
+  };
+  vector<AEinfo_t> infos(sboxes_vec.size());
+
+  #pragma omp parallel for num_threads(omp_nb_threads)
+  for (int i = 0; i < (int)sboxes_vec.size(); i++)
+  {
+    AEinfo_t & info = infos[i];
+    info.f.parse_function(sboxes_vec[i].second);
+    if (info.f.is_permutation())
+    {
+      // R(x) = LB^-1(S(LA(x) + c) + d)
+      info.f.AE_representative(info.R, info.LA, info.LB, info.c, info.d);
+    }
+  }
+
+  ofstream outf(outputfile.c_str(), ios::app);
+  outf
+    << "Cipher"          << ","
+    << "LUT"             << ","
+    << "AE_Class"        << ","
+    << "New_Class"       << ","
+    << "Representative"  << ","
+    << "A"               << ","
+    << "a"               << ","
+    << "B"               << ","
+    << "b"
+    << endl;
+  for (int i = 0; i < (int)sboxes_vec.size(); i++)
+  {
+    const AEinfo_t & info = infos[i];
+    outf << sboxes_vec[i].first << "," << info.f.LUT_to_string() << ",";
+    if (!info.f.is_permutation())
+    {
+      outf << "-1,-,-,-,-,-,-" << endl;
+      continue;
+    }
+    array<uint8_t, LUT_UNIT_N> R;
+    memcpy(R.data(), (uint8_t *)info.R.LUT, sizeof(uint8_t) * LUT_UNIT_N);
+    bool known = (classes.find(R) != -1);
+    int ci = classes.insert(R);
+    function_t<N> A = info.LA.inverse();
+    outf << ci << ","
+         << (known ? "No" : "Yes") << ","
+         << info.R.LUT_to_string() << ","
+         << A.LUT_to_string() << ","
+         << ((uint8_t *)A.LUT)[info.c] + '\0' << ","
+         << info.LB.LUT_to_string() << ","
+         << info.d + '\0'
+         << endl;
+  }
+  outf.close();
+
+  classes.save(classesfile);
+  cout << "AE classes : " << sboxes_vec.size() << " S-boxes, " << classes.reps.size()
+       << " classes in " << classesfile << " (" << (classes.reps.size() - known_n) << " new)" << endl;
 }
 
 template<int N>
@@ -0,0 +1,280 @@
+/**
+ * PEIGEN: a Platform for Evaluation, Implementation, and Generation of S-boxes
+ *
+ *  Copyright 2019 by
+ *    Zhenzhen Bao <baozhenzhen10[at]gmail.com>
+ *    Jian Guo <guojian[at]ntu.edu.sg>
+ *    San Ling <lingsan[at]ntu.edu.sg>
+ *    Yu Sasaki <yu[dot]sasaki[dot]sk@hco.ntt.co.jp>
+ * 
+ * This platform is developed based on the open source application
+ * <http://jeremy.jean.free.fr/pub/fse2018_layer_implementations.tar.gz>
+ * Optimizing Implementations of Lightweight Building Blocks
+ *
+ *  Copyright 2017 by
+ *    Jade Tourteaux <Jade[dot]Tourteaux[at]gmail.com>
+ *    Jérémy Jean <Jean[dot]Jeremy[at]gmail.com>
+ * 
+ * We follow the same copyright policy.
+ * 
+ * This file is part of some open source application.
+ * 
+ * Some open source application is free software: you can redistribute 
+ * it and/or modify it under the terms of the GNU General Public 
+ * License as published by the Free Software Foundation, either 
+ * version 3 of the License, or (at your option) any later version.
+ * 
+ * Some open source application is distributed in the hope that it will 
+ * be useful, but WITHOUT ANY WARRANTY; without even the implied warranty 
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Foobar.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @license GPL-3.0+ <http://spdx.org/licenses/GPL-3.0+>
+ */
+
+#ifndef LIGHTER_SHARD_H__
+#define LIGHTER_SHARD_H__
+
+#include "func.hpp"
+
+using namespace Peigen;
+using namespace Peigen::weight;
+using namespace std;
+
+/*
+  Sharding of generate().
+  With --shard i/k, generate() checks only the positions p of each layer c1
+  such that p % k == i (see checkpoint_layer()), and writes its outputs
+  in the directory shard<i>of<k>/. The precomputed pre_*.bin files are shared.
+  merge_shards() with --merge k combines the outputs of the k shards.
+*/
+
+template<int N>
+string lighter<N>::shard_dir(int i, int k)
+{
+  return "shard" + to_string(i) + "of" + to_string(k) + "/";
+}
+
+template<int N>
+void lighter<N>::merge_shards(string args)
+{
+  clock_t t1 = clock();
+
+  pre_parse_args();
+  while ((opt = getopt_long(myargc, myargv, "o:l:c:vwap:f:r:s:", longopts, NULL)) != EOF)
+  {
+    switch(opt)
+    {
+      case 'a': all_gates(); break;
+      case 'v': verbose = true; break;
+      case 'o': sboxesfile = optarg; break;
+      case 'f': conf_file = optarg; break;
+      case 'M': merge_k = atoi(optarg); break;
+      case '?': fprintf(stderr, "wrong cmd line");
+    }
+  }
+  post_parse_args();
+
+  genImpInfo();
+
+  if (merge_k < 1)
+  {
+    cout << "Error: --merge expects the number of shards" << endl;
+    reset();
+    return;
+  }
+
+  /*
+    Each shard tightens Cost_Criteria on its own, so a shard may have kept
+    S-boxes costlier than those of another one: only the S-boxes at the
+    smallest final bound of the shards (in their last checkpoint) are kept.
+  */
+  int cost_bound = -1;
+  for (int i = 0; i < merge_k; i++)
+  {
+    ifstream fin(shard_dir(i, merge_k) + imp_info + "__checkpoint.txt");
+    map<string, string> values;
+    for (string line; getline(fin, line); )
+    {
+      istringstream is_line(line);
+      string key;
+      is_line >> key;
+      getline(is_line >> ws, values[key]);
+    }
+    if (atoi(values["phase"].c_str()) != 3)
+    {
+      cout << "Error: the shard " << i << "/" << merge_k << " is not completed, its S-boxes are merged as they are" << endl;
+      continue;
+    }
+    int shard_cost = atoi(values["Cost_Criteria"].c_str());
+    if ((cost_bound == -1) || (shard_cost < cost_bound)) cost_bound = shard_cost;
+  }
+
+  // the fields of a line of statistics, "(v, w)" fields are quoted
+  auto csv_fields = [](const string & line)
+  {
+    vector<string> fields(1);
+    bool quoted = false;
+    for (char ch : line)
+    {
+      if (ch == '"') quoted = !quoted;
+      if ((ch == ',') && !quoted) fields.push_back("");
+      else fields.back() += ch;
+    }
+    return fields;
+  };
+
+  // The statistics, one row per S-box, named <shard>_<name>
+  string outfn = imp_info + "__" + "statistics.csv";
+  ofstream outf(outfn.c_str());
+  evaluate_writeTitleLine(outf);
+  set<string> sboxes;
+  int dup_number = 0;
+  int costlier_number = 0;
+  for (int i = 0; i < merge_k; i++)
+  {
+    string dir = shard_dir(i, merge_k);
+    for (int tid = 0; ; tid++)
+    {
+      ifstream inf(dir + imp_info + "__" + "statistics_Part" + to_string(tid) + ".csv");
+      if (!inf) break;
+      int cost_col = -1;
+      for (string line; getline(inf, line); )
+      {
+        vector<string> fields = csv_fields(line);
+        if (fields[0] == "Cipher")
+        {
+          for (int j = 0; j < (int)fields.size(); j++)
+          {
+            if (fields[j].compare(0, 9, "Cost (GE)") == 0) cost_col = j;
+          }
+          continue;
+        }
+        if (fields.size() < 2) continue;
+        string LUT_str = fields[1];
+        if ((cost_bound != -1) && (cost_col != -1) && (cost_col < (int)fields.size()) &&
+            ((int)floor(atof(fields[cost_col].c_str()) * 100 + 0.5) > cost_bound))
+        {
+          costlier_number++;
+          continue;
+        }
+        if (sboxes.insert(LUT_str).second) outf << i << "_" << line << endl;
+        else dup_number++;
+      }
+    }
+  }
+  outf.close();
+
+  // The folders named after the property profiles:
+  // the implementations of the PE representatives and the lists of the kept S-boxes
+  map<string, string> folder; // folder of each S-box
+  set<string> lists;
+  set<pair<string, string> > listed;
+  for (int i = 0; i < merge_k; i++)
+  {
+    string dir = shard_dir(i, merge_k);
+    DIR * shard = opendir(dir.c_str());
+    if (shard == NULL) continue;
+    for (struct dirent * entry = readdir(shard); entry != NULL; entry = readdir(shard))
+    {
+      string fn_prefix = entry->d_name;
+      struct stat dirstate;
+      if ((fn_prefix == ".") || (fn_prefix == "..") ||
+          (stat((dir + fn_prefix).c_str(), &dirstate) != 0) || !S_ISDIR(dirstate.st_mode)) continue;
+
+      DIR * profile = opendir((dir + fn_prefix).c_str());
+      if (profile == NULL)
+      {
+        cout << "Error: cannot open " << dir + fn_prefix << endl;
+        continue;
+      }
+      vector<string> fns;
+      for (struct dirent * file = readdir(profile); file != NULL; file = readdir(profile))
+      {
+        string fn = file->d_name;
+        if ((fn != ".") && (fn != "..")) fns.push_back(fn);
+      }
+      closedir(profile);
+
+      // the lines of the lists which are kept, the folder is left out if there is none
+      map<string, vector<string> > kept_lines;
+      for (auto & fn : fns)
+      {
+        if ((fn.size() > 2) && (fn.substr(fn.size() - 2) == ".c")) continue;
+        ifstream src_f(dir + fn_prefix + "/" + fn);
+        for (string line; getline(src_f, line); )
+        {
+          string LUT_str = line.substr(line.find(',') + 1);
+          if (sboxes.count(LUT_str) != 0) kept_lines[fn].push_back(line);
+        }
+      }
+      if (kept_lines.empty()) continue;
+
+      if ((stat(fn_prefix.c_str(), &dirstate) != 0) && (mkdir(fn_prefix.c_str(), 0777) == -1))
+      {
+        cout << "Error creating directory!"  << endl;
+        continue;
+      }
+      for (auto & fn : fns)
+      {
+        string src = dir + fn_prefix + "/" + fn;
+        string dst = fn_prefix + "/" + fn;
+        struct stat filestate;
+        if ((fn.size() > 2) && (fn.substr(fn.size() - 2) == ".c"))
+        {
+          if (stat(dst.c_str(), &filestate) != 0)
+          {
+            ifstream src_f(src, ios::binary);
+            ofstream dst_f(dst, ios::binary);
+            dst_f << src_f.rdbuf();
+          }
+        }
+        else if (kept_lines.count(fn) != 0)
+        {
+          ofstream dst_f(dst, lists.insert(dst).second ? ios::trunc : ios::app);
+          for (auto & line : kept_lines[fn])
+          {
+            string LUT_str = line.substr(line.find(',') + 1);
+            folder[LUT_str] = fn_prefix;
+            if (listed.insert(make_pair(dst, LUT_str)).second) dst_f << i << "_" << line << endl;
+          }
+        }
+      }
+    }
+    closedir(shard);
+  }
+
+  // The PE representatives, numbered again;
+  // as for the implementations, they are distinct in each folder
+  set<string> PE_reps;
+  ofstream PEsboxf(imp_info + "_PEsboxes.txt");
+  for (int i = 0; i < merge_k; i++)
+  {
+    ifstream inf(shard_dir(i, merge_k) + imp_info + "_PEsboxes.txt");
+    for (string line; getline(inf, line); )
+    {
+      string LUT_str = line.substr(line.find(',') + 1);
+      if (sboxes.count(LUT_str) == 0) continue;
+      function_t<N> f(LUT_str);
+      if (PE_reps.insert(folder[LUT_str] + "/" + f.PE_representative().to_string()).second)
+      {
+        PEsboxf << PE_reps.size() << "," << LUT_str << endl;
+      }
+    }
+  }
+  PEsboxf.close();
+
+  cout << "Merged " << merge_k << " shards : " << sboxes.size() << " S-boxes ("
+       << dup_number << " duplicates, " << costlier_number << " above the cost "
+       << (double)cost_bound/100 << " GE), " << PE_reps.size() << " PE representatives" << endl;
+
+  reset();
+
+  t1 = clock() - t1;
+  cout << "Takes time (mins): " << (((double)t1) / (CLOCKS_PER_SEC * 60.0)) << endl;
+}
+
+#endif // LIGHTER_SHARD_H__
@@ -51,26 +51,63 @@ void lighter<N>::print_graphe_info()
 
   cout << "\n\033[0;31mf1_succ : \033[0m";
 
-  auto it = f1_succ.begin();
+  auto it = f1_succ.layers.begin();
 
-  while (it != f1_succ.end())
+  while (it != f1_succ.layers.end())
   {
-    cout << (*it).first << " (" << (*it).second.size() << ") ";
-    tot_f1 += ((*it).second.size());
+    cout << (*it).first << " (" << (*it).second.size << ") ";
+    tot_f1 += ((*it).second.size);
     it++;
   }
   cout << "\n\033[1;33mTotal = " << tot_f1;
   cout << "\n\033[0;31mf2_succ : \033[0m";
-  it = f2_succ.begin();
-  while (it != f2_succ.end())
+  it = f2_succ.layers.begin();
+  while (it != f2_succ.layers.end())
   {
-    cout << (*it).first << " (" << (*it).second.size() << ") ";
-    tot_f2 += ((*it).second.size());
+    cout << (*it).first << " (" << (*it).second.size << ") ";
+    tot_f2 += ((*it).second.size);
     it++;
   }
   cout << "\n\033[1;33mTotal = " << tot_f2 << "\033[0m\n";
 }
 
+template<int N>
+void lighter<N>::print_criteria_stats()
+{
+  static const char * crit_names[CRIT_NB] = {"Involution", "DDT_row", "DDT", "LAT", "Degree"};
+
+  crit_stats_t sum;
+  sum.nb = crit_stages.size();
+  for (int i = 0; i < sum.nb; i++) sum.order[i] = crit_stages[i];
+  for (auto & st : crit_stats)
+  {
+    sum.total += st.total;
+    for (int s = 0; s < CRIT_NB; s++)
+    {
+      sum.calls[s] += st.calls[s];
+      sum.rejects[s] += st.rejects[s];
+      sum.cycles[s] += st.cycles[s];
+      sum.samples[s] += st.samples[s];
+    }
+  }
+  if (sum.total == 0) return;
+  crit_adapt(sum);
+
+  cout << "Criteria order :";
+  for (int i = 0; i < sum.nb; i++) cout << (i ? " > " : " ") << crit_names[sum.order[i]];
+  cout << endl;
+  for (int i = 0; i < sum.nb; i++)
+  {
+    int s = sum.order[i];
+    cout << "  " << setw(10) << left << crit_names[s] << right
+         << " : " << sum.calls[s] << " tested, " << sum.rejects[s] << " rejected ("
+         << fixed << setprecision(1) << (sum.calls[s] ? (100.0 * sum.rejects[s] / sum.calls[s]) : 0.0) << "%), "
+         << (sum.samples[s] ? (sum.cycles[s] / sum.samples[s]) : 0) << " cycles" << endl;
+  }
+  cout.unsetf(ios::floatfield);
+  cout << setprecision(6);
+}
+
 template<int N>
 void lighter<N>::exit_m()
 {
@@ -84,7 +121,7 @@ void lighter<N>::exit_m()
 }
 
 template<int N>
-void lighter<N>::graphe_to_file(map<int, set<function_t<N> > > *graphe,
+void lighter<N>::graphe_to_file(graphe_t<N> *graphe,
                     string graphe_name)
 {
   string name;
@@ -94,21 +131,21 @@ void lighter<N>::graphe_to_file(map<int, set<function_t<N> > > *graphe,
   */
   ofstream file_info(graphe_name + "_infos.txt");
   file_info << "Number of lists in graph : "
-            << graphe->size()
+            << graphe->layers.size()
             << endl;
-  auto it_graphe = graphe->begin();
-  while(it_graphe != graphe->end())
+  auto it_graphe = graphe->layers.begin();
+  while(it_graphe != graphe->layers.end())
   {
-    if((*it_graphe).second.size() != 0)
+    if((*it_graphe).second.size != 0)
     {
-      tot_number += (*it_graphe).second.size();
+      tot_number += (*it_graphe).second.size;
       file_info << "Number of nodes in list "
               << (*it_graphe).first
               << " : "
-              <<  (*it_graphe).second.size()
+              <<  (*it_graphe).second.size
               << endl;
     }
-    if((*it_graphe).second.size() != 0)
+    if((*it_graphe).second.size != 0)
     {
       name = graphe_name
             + string("_list_")
@@ -121,11 +158,9 @@ void lighter<N>::graphe_to_file(map<int, set<function_t<N> > > *graphe,
       */
       if(file_list.is_open())
       {
-        auto it_curr = (*it_graphe).second.begin();
-        while(it_curr != (*it_graphe).second.end())
+        for (auto i : graphe->layer((*it_graphe).first))
         {
-          file_list << (*it_curr).to_string()<<endl;
-          it_curr++;
+          file_list << graphe->node(i).to_string()<<endl;
         }
       }
       file_list.close();
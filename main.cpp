@@ -392,8 +392,16 @@ int main(int argc, char *argv[])
 	}
 	// Note, if the graph under a same configuration has already been pre computed and stored,
 	// The line ``pre_compute(args)'' can be commented.
-	sbox3_GEN.pre_compute(args);
-	sbox3_GEN.generate(args);
+	// The outputs of the processes run with ``--shard i/k'' are merged by running with ``--merge k''.
+	if (args.find("--merge") != string::npos)
+	{
+		sbox3_GEN.merge_shards(args);
+	}
+	else
+	{
+		sbox3_GEN.pre_compute(args);
+		sbox3_GEN.generate(args);
+	}
 	t1 = clock() - t0;
 	cout << "Total time (mins): " << (((double)t1) / (CLOCKS_PER_SEC * 60.0)) << endl;
 #endif
@@ -408,8 +416,16 @@ int main(int argc, char *argv[])
 	}
 	// Note, if the graph under a same configuration has already been pre computed and stored,
 	// The line ``pre_compute(args)'' can be commented.
-	sbox4_GEN.pre_compute(args);
-	sbox4_GEN.generate(args);
+	// The outputs of the processes run with ``--shard i/k'' are merged by running with ``--merge k''.
+	if (args.find("--merge") != string::npos)
+	{
+		sbox4_GEN.merge_shards(args);
+	}
+	else
+	{
+		sbox4_GEN.pre_compute(args);
+		sbox4_GEN.generate(args);
+	}
 	t1 = clock() - t0;
 	cout << "Total time (mins): " << (((double)t1) / (CLOCKS_PER_SEC * 60.0)) << endl;
 #endif